@@ -1,36 +1,135 @@
 #pragma once
 
-#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace HSharpParser {
-    class ArenaAllocator {
+    struct ArenaStats {
+        /* alloc*() calls since construction or the last reset() */
+        std::size_t allocations = 0;
+        /* Bytes handed out, alignment padding included */
+        std::size_t bytes_used = 0;
+        /* Usable bytes across all chunks held, spares included */
+        std::size_t bytes_reserved = 0;
+        std::size_t chunks = 0;
+    };
+
+    /* Bump allocator over a list of chunks. A full chunk is never reallocated, so pointers
+     * stay valid until release()/reset() or destruction; new chunks double in size up to a
+     * cap, and requests larger than that get a chunk of their own. Nothing allocated here
+     * is destroyed, so only trivially destructible types are accepted.
+     *
+     * As a std::pmr::memory_resource it backs pmr containers; deallocate() is a no-op, so
+     * their memory comes back all at once with release() or destruction, or is kept for reuse
+     * by reset().
+     *
+     * In guard-page mode every chunk is mmap()ed with an inaccessible page right after its
+     * usable bytes, so running off the end of a chunk faults instead of silently corrupting
+     * whatever the heap put next to it. */
+    class ArenaAllocator final : public std::pmr::memory_resource {
     private:
-        size_t allocated_size;
-        char* current_offset;
-        void* mem_block_start;
+        /* Over-aligned so that begin() is suitably aligned for any fundamental type */
+        struct alignas(std::max_align_t) Chunk {
+            Chunk* previous;
+            /* Usable bytes following the header */
+            std::size_t size;
+            /* Bytes mapped for the chunk, guard page included; 0 when malloc()ed */
+            std::size_t mapped;
+
+            [[nodiscard]] char* begin() { return reinterpret_cast<char*>(this + 1); }
+        };
+
+        static constexpr std::size_t max_chunk_size = std::size_t{64} << 20;
+
+        Chunk* current = nullptr;
+        /* Chunks emptied by reset(), handed out again before anything new is allocated */
+        Chunk* spare = nullptr;
+        char* cursor = nullptr;
+        char* limit = nullptr;
+        std::size_t next_chunk_size;
+        bool guard_pages;
+        ArenaStats counters;
+        /* bytes_used of every chunk before current */
+        std::size_t retired_used = 0;
+
+        /* Reports and exits; allocation failures are not recoverable for the callers */
+        [[noreturn]] static void fail(const char* message);
+        void* allocate_slow(std::size_t bytes, std::size_t alignment);
+        void add_chunk(std::size_t min_bytes);
+        void push_chunk(Chunk* chunk);
+        void free_chunk(Chunk* chunk);
+        void free_chunks_after(const Chunk* keep);
+        void free_spares();
+
+        void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+            return allocate_bytes(bytes, alignment);
+        }
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
     public:
-        inline explicit ArenaAllocator(ArenaAllocator& alloc) = delete;
-        inline ArenaAllocator operator=(ArenaAllocator& alloc) = delete;
-        inline explicit ArenaAllocator(size_t bytes) : allocated_size(bytes) {
-            mem_block_start = malloc(bytes);
-            current_offset = static_cast<char*>(mem_block_start);
-            if (!mem_block_start) {
-                std::cerr << "ArenaAllocator failed to allocate memory: malloc() returned null" << std::endl;
-                exit(1);
+        /* Position to roll back to with release() */
+        struct Mark {
+            Chunk* chunk;
+            char* cursor;
+            std::size_t allocations;
+            std::size_t retired_used;
+        };
+
+        explicit ArenaAllocator(std::size_t initial_chunk_size = 64 * 1024, bool guard_pages = false)
+            : next_chunk_size(initial_chunk_size ? initial_chunk_size : 1), guard_pages(guard_pages) {}
+        ArenaAllocator(const ArenaAllocator&) = delete;
+        ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+        ArenaAllocator(ArenaAllocator&& other) noexcept;
+        ArenaAllocator& operator=(ArenaAllocator&& other) noexcept;
+        ~ArenaAllocator() override;
+
+        /* Raw storage; alignment must be a power of two */
+        [[nodiscard]] void* allocate_bytes(const std::size_t bytes, const std::size_t alignment) {
+            const auto address = reinterpret_cast<std::uintptr_t>(cursor);
+            const std::uintptr_t aligned = (address + alignment - 1) & ~(alignment - 1);
+            /* Both checks compare distances, so a huge request cannot wrap the pointer */
+            if (cursor && aligned - address <= static_cast<std::size_t>(limit - cursor) &&
+                bytes <= static_cast<std::size_t>(limit - cursor) - (aligned - address)) {
+                cursor = reinterpret_cast<char*>(aligned) + bytes;
+                counters.allocations++;
+                return reinterpret_cast<void*>(aligned);
             }
+            return allocate_slow(bytes, alignment);
         }
-        inline ~ArenaAllocator() {
-            free(mem_block_start);
-            mem_block_start = current_offset = nullptr;
-            allocated_size = 0;
+
+        template<typename T>
+        T* alloc() {
+            static_assert(std::is_trivially_destructible_v<T>, "ArenaAllocator never runs destructors");
+            return new(allocate_bytes(sizeof(T), alignof(T))) T();
         }
 
+        /* count value-initialized elements */
         template<typename T>
-        inline T* alloc() {
-            T* ptr = new(current_offset)T();
-            current_offset += sizeof(T);
-            return ptr;
+        T* alloc_array(const std::size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>, "ArenaAllocator never runs destructors");
+            if (count > SIZE_MAX / sizeof(T))
+                fail("ArenaAllocator: array size overflows");
+            T* array = static_cast<T*>(allocate_bytes(sizeof(T) * count, alignof(T)));
+            for (std::size_t i = 0; i < count; i++)
+                new(array + i) T();
+            return array;
         }
 
+        [[nodiscard]] Mark mark() const { return {current, cursor, counters.allocations, retired_used}; }
+        /* Frees everything allocated after mark was taken */
+        void release(const Mark& mark);
+        /* Invalidates everything allocated but frees no chunk: all of them become spares for
+         * the next round, so a reused arena stops touching fresh pages once it has seen its
+         * largest workload. Only release() and destruction give memory back. */
+        void reset();
+
+        [[nodiscard]] ArenaStats stats() const;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+/* Synthetic H# sources for hve_bench. Every generator is deterministic, so results stay
+ * comparable across versions, and produces programs that run to completion without exit()
+ * or input(). */
+namespace HSharpBench {
+    enum class Workload {
+        EXPRESSIONS,
+        VARIABLES,
+        STRINGS,
+        COMMENTS,
+        PRINTS,
+        /* Meant to be parsed with deduplication; see needs_deduplication() */
+        REPEATED
+    };
+
+    inline constexpr std::array workloads = {
+        Workload::EXPRESSIONS,
+        Workload::VARIABLES,
+        Workload::STRINGS,
+        Workload::COMMENTS,
+        Workload::PRINTS,
+        Workload::REPEATED,
+    };
+
+    /* Workloads whose point is the node sharing hash-consing produces */
+    [[nodiscard]] constexpr bool needs_deduplication(const Workload workload) {
+        return workload == Workload::REPEATED;
+    }
+
+    [[nodiscard]] std::string_view workload_name(Workload workload);
+    /* Roughly statements top-level statements shaped like workload */
+    [[nodiscard]] std::string generate(Workload workload, std::size_t statements);
+
+    /* Lexer-heavy input of at least target_size bytes: long literals, comments and identifiers */
+    [[nodiscard]] std::string generate_lexer_input(std::size_t target_size);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cinttypes>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <parser/parser.hpp>
+#include <parser/symbols.hpp>
+
+/* Program images: a parsed program written to disk exactly as the VE reads it. Every section is
+ * an array of fixed-layout records addressed by file offset, so a mapped image is used in place,
+ * with no pointer fix-up and no parsing. Images are only valid for the engine build and the
+ * source bytes and front-end options they were made from; all are checked on load. */
+namespace HSharpParser {
+    /* Front-end options that change the nodes an image holds, and so are part of its key */
+    enum FrontEndFlags : std::uint32_t {
+        FRONT_END_DEDUPLICATE = 1u << 0
+    };
+
+    /* Cache lookups since the cache directory was created */
+    struct CacheStats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t write_failures = 0;
+    };
+
+    /* 64-bit content hash used to key cached images */
+    [[nodiscard]] std::uint64_t hash_source(std::string_view source);
+
+    class ProgramImage {
+    private:
+        void* mapping = nullptr;
+        std::size_t mapping_size = 0;
+        ProgramView program;
+        /* Symbol names, in id order, packed as records into the mapping */
+        const std::uint32_t* symbol_records = nullptr;
+        std::uint32_t symbol_count = 0;
+        std::string_view symbol_data;
+
+        ProgramImage() = default;
+
+    public:
+        ProgramImage(const ProgramImage&) = delete;
+        ProgramImage& operator=(const ProgramImage&) = delete;
+        ProgramImage(ProgramImage&& other) noexcept;
+        ProgramImage& operator=(ProgramImage&& other) noexcept;
+        ~ProgramImage();
+
+        /* Maps and validates the image at path; empty if it is missing, was made by another
+         * engine version, from a different source or with other front-end flags, or fails any
+         * bounds check */
+        static std::optional<ProgramImage> load(const std::string& path, std::uint64_t source_hash,
+                                                std::uint64_t source_size, std::uint32_t front_end_flags);
+        /* Writes program atomically (temporary file, then rename); false on any I/O error */
+        static bool write(const std::string& path, const NodeProgram& program, const SymbolTable& symbols,
+                          std::uint64_t source_hash, std::uint64_t source_size, std::uint32_t front_end_flags);
+
+        [[nodiscard]] ProgramView view() const { return program; }
+        /* Re-interns the image's symbols so that ids match the ones stored in its nodes */
+        void restore_symbols(SymbolTable& symbols) const;
+    };
+
+    /* Directory of images named after source hash and size, front-end flags and engine version,
+     * plus a stats file: $XDG_CACHE_HOME/hsharpve, falling back to ~/.cache/hsharpve */
+    class ImageCache {
+    private:
+        std::string directory;
+
+        explicit ImageCache(std::string directory) : directory(std::move(directory)) {}
+
+    public:
+        /* Creates the directory if needed; empty if there is no usable location */
+        static std::optional<ImageCache> open();
+
+        [[nodiscard]] std::string path_for(std::uint64_t source_hash, std::uint64_t source_size,
+                                           std::uint32_t front_end_flags) const;
+        /* Adds one run's lookups to the persisted counts and returns the new totals; the counts
+         * are best effort and a run that cannot update them still gets the totals */
+        CacheStats record(const CacheStats& run) const;
+        [[nodiscard]] const std::string& path() const { return directory; }
+    };
+}
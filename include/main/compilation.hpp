@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+
+#include <arena_alloc/arena.hpp>
+#include <image/image.hpp>
+#include <main/file.hpp>
+#include <parser/parser.hpp>
+#include <parser/symbols.hpp>
+
+namespace HSharpParser {
+    class ThreadPool;
+
+    /* Everything one program's front end produces, owned in one place and moved, never
+     * copied, from stage to stage: the source, its tokens, the AST (or the cached image
+     * standing in for it), the symbol table and the arenas all of them live in. The VE only
+     * ever gets a view(), so it must not outlive the Compilation.
+     *
+     * Stages run in order: tokenize() (optional; parse() lexes on demand without it),
+     * parse(), link() when the program imports anything, then release_front_end() once the
+     * source and tokens are no longer needed. adopt() replaces all of them with an image. */
+    class Compilation {
+    private:
+        std::optional<File> source;
+        /* Boxed because pmr containers hold their resource's address, which has to survive
+         * moves of the Compilation. Tokens get an arena of their own so that they can be
+         * freed as soon as the AST is built. */
+        std::unique_ptr<ArenaAllocator> arena;
+        std::unique_ptr<ArenaAllocator> token_arena;
+        SymbolTable symbols;
+        std::optional<std::pmr::vector<Token>> tokens;
+        std::optional<NodeProgram> program;
+        std::optional<ProgramImage> image;
+        std::size_t folded = 0;
+        std::size_t shared = 0;
+        std::size_t modules = 1;
+
+    public:
+        explicit Compilation(File source);
+        Compilation(const Compilation&) = delete;
+        Compilation& operator=(const Compilation&) = delete;
+        Compilation(Compilation&&) noexcept = default;
+        /* Assigning over a live AST would copy it element-wise, its arena being a different one */
+        Compilation& operator=(Compilation&&) = delete;
+
+        /* Empty, with the reason printed, if path cannot be read */
+        static std::optional<Compilation> open(const std::string& path);
+
+        /* Lexes the whole source up front, split across pool when one is given; exits on lexical
+         * errors */
+        void tokenize(ThreadPool* pool = nullptr);
+        /* Exits on syntax errors */
+        void parse(bool deduplicate = false);
+        [[nodiscard]] bool has_imports() const;
+        /* Loads and links the imported modules on pool; false, with the reason printed, if
+         * one cannot be read or does not parse */
+        bool link(ThreadPool& pool);
+        /* Runs from a cached image instead of the source */
+        void adopt(ProgramImage cached);
+        /* Frees the tokens and unmaps the source; the AST and symbols own everything they use */
+        void release_front_end();
+
+        [[nodiscard]] const File& source_file() const { return source.value(); }
+        /* 0 unless tokenize() ran and release_front_end() has not */
+        [[nodiscard]] std::size_t token_count() const { return tokens ? tokens->size() : 0; }
+        /* Only set after parse() */
+        [[nodiscard]] const NodeProgram& ast() const { return program.value(); }
+        [[nodiscard]] ProgramView view() const { return image ? image->view() : program->view(); }
+        [[nodiscard]] const SymbolTable& symbol_table() const { return symbols; }
+        /* Long-lived memory, for the VE to draw from as well */
+        [[nodiscard]] std::pmr::memory_resource* memory() const { return arena.get(); }
+        [[nodiscard]] ArenaStats arena_stats() const { return arena->stats(); }
+        /* All zeroes once release_front_end() has freed the token arena */
+        [[nodiscard]] ArenaStats token_arena_stats() const { return token_arena ? token_arena->stats() : ArenaStats{}; }
+
+        [[nodiscard]] std::size_t folded_constants() const { return folded; }
+        [[nodiscard]] std::size_t shared_expressions() const { return shared; }
+        [[nodiscard]] std::size_t module_count() const { return modules; }
+    };
+}
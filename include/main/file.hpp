@@ -1,11 +1,60 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <optional>
+#include <vector>
 
 #include <cinttypes>
 
-struct File{
-    std::optional<std::string> contents;
-    std::uint64_t size;
-};
\ No newline at end of file
+/* 1-based line and byte column of a source offset */
+struct SourceLocation {
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+/* Source text of a script. Regular files are memory-mapped (MAP_PRIVATE) and read straight
+ * from the page cache; pipes, /dev/stdin and anything else mmap() refuses are read in chunks
+ * into an owned buffer. Either way contents() stays valid, at the same address, for the
+ * lifetime of the File, including across moves. */
+class File {
+private:
+    std::string path = "<memory>";
+    std::string buffer;
+    void* mapping = nullptr;
+    std::size_t mapping_size = 0;
+    std::string_view data;
+    /* Offsets of every line start, built on the first location() query only */
+    mutable std::vector<std::uint32_t> line_starts;
+
+    void release();
+    void build_line_index() const;
+
+public:
+    File() = default;
+    /* Wraps text that is already in memory */
+    explicit File(std::string contents);
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    File(File&& other) noexcept;
+    File& operator=(File&& other) noexcept;
+    ~File();
+
+    /* Returns nothing and prints the reason if the file cannot be opened or read */
+    static std::optional<File> open(const std::string& path);
+
+    [[nodiscard]] std::string_view contents() const { return data; }
+    [[nodiscard]] std::uint64_t size() const { return data.size(); }
+    [[nodiscard]] bool is_mapped() const { return mapping != nullptr; }
+    [[nodiscard]] const std::string& name() const { return path; }
+
+    /* Replaces [begin, end) with replacement, copying a mapped file into memory first.
+     * Invalidates contents() and every offset past begin; returns false if the range is
+     * out of bounds or the result would exceed the 4 GiB limit. */
+    bool edit(std::uint32_t begin, std::uint32_t end, std::string_view replacement);
+
+    /* Tokens only carry byte offsets; these translate one for diagnostics, profilers and tracers */
+    [[nodiscard]] SourceLocation location(std::uint32_t offset) const;
+    /* "path:line:column" */
+    [[nodiscard]] std::string describe(std::uint32_t offset) const;
+};
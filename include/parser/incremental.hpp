@@ -0,0 +1,54 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include <main/file.hpp>
+#include <parser/parser.hpp>
+#include <parser/symbols.hpp>
+
+namespace HSharpParser {
+    /* Replace source bytes [begin, end) with replacement */
+    struct TextEdit {
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::string replacement;
+    };
+
+    /* Keeps a program parsed while its source is being edited. An edit re-lexes and re-parses
+     * from the start of the first statement it touches until the new statement boundaries line
+     * up with old ones again; everything past that point is kept and only has its span shifted.
+     * Nodes refer to the source only by their operators' offsets, which are shifted along with
+     * the spans, so unchanged statements survive the text moving.
+     *
+     * Source being edited spends most of its time not parsing. An edit that leaves a syntax
+     * error is still applied to the file, but the program stays the last one that parsed, and
+     * the next edit parses the whole file again. */
+    class IncrementalParser {
+    private:
+        File& file;
+        SymbolTable& symbols;
+        NodeProgram parsed;
+        /* Expression nodes of replaced statements still occupying parsed.expressions */
+        std::size_t garbage = 0;
+        /* Set while the file does not parse; the program's spans then no longer match it */
+        std::optional<SyntaxError> failure;
+
+        /* Parses the whole file; false, with failure set, if it does not parse */
+        bool reparse();
+
+    public:
+        /* file and symbols must outlive the parser; file should only be edited through apply() */
+        IncrementalParser(File& file, SymbolTable& symbols);
+
+        /* Applies edit to the file and brings the program up to date. Returns the number of
+         * statements parsed to do so, or nothing if the edit range is invalid (the file is left
+         * alone) or the edited file does not parse (see error()). */
+        std::optional<std::size_t> apply(const TextEdit& edit);
+
+        /* The last version of the file that parsed */
+        [[nodiscard]] const NodeProgram& program() const { return parsed; }
+        /* Why the file as it stands does not parse, if it does not */
+        [[nodiscard]] const std::optional<SyntaxError>& error() const { return failure; }
+    };
+}
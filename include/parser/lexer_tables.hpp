@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cinttypes>
+#include <optional>
+#include <string_view>
+
+#include <parser/parser.hpp>
+
+/* Lookup tables driving HSharpParser::Tokenizer. Everything here is computed at compile time
+ * from the keyword list below, so adding a keyword is a one-line change and never adds a
+ * string compare to the lexer's hot path. */
+namespace HSharpParser::Tables {
+    enum class CharClass : std::uint8_t {
+        INVALID,
+        SPACE,
+        ALPHA,
+        DIGIT,
+        QUOTE,
+        SLASH,
+        PUNCT
+    };
+
+    struct CharInfo {
+        CharClass cls = CharClass::INVALID;
+        TokenType token{};
+    };
+
+    struct Keyword {
+        std::string_view word;
+        TokenType ttype;
+    };
+
+    /* Single source of truth for reserved words */
+    inline constexpr std::array keywords = {
+        Keyword{"exit", TokenType::TOK_EXIT},
+        Keyword{"var", TokenType::TOK_VAR},
+        Keyword{"print", TokenType::TOK_PRINT},
+        Keyword{"input", TokenType::TOK_INPUT},
+        Keyword{"if", TokenType::TOK_IF},
+        Keyword{"import", TokenType::TOK_IMPORT},
+    };
+
+    inline constexpr std::array<CharInfo, 256> char_table = [] {
+        std::array<CharInfo, 256> table{};
+        for (unsigned c = 'a'; c <= 'z'; c++) table[c].cls = CharClass::ALPHA;
+        for (unsigned c = 'A'; c <= 'Z'; c++) table[c].cls = CharClass::ALPHA;
+        for (unsigned c = '0'; c <= '9'; c++) table[c].cls = CharClass::DIGIT;
+        for (const unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[c].cls = CharClass::SPACE;
+        table['"'].cls = CharClass::QUOTE;
+        table['/'] = {CharClass::SLASH, TokenType::TOK_FSLASH};
+        table[';'] = {CharClass::PUNCT, TokenType::TOK_SEMICOLON};
+        table['('] = {CharClass::PUNCT, TokenType::TOK_PAREN_OPEN};
+        table[')'] = {CharClass::PUNCT, TokenType::TOK_PAREN_CLOSE};
+        table['{'] = {CharClass::PUNCT, TokenType::TOK_CURLY_OPEN};
+        table['}'] = {CharClass::PUNCT, TokenType::TOK_CURLY_CLOSE};
+        table['='] = {CharClass::PUNCT, TokenType::TOK_EQUALITY_SIGN};
+        table['+'] = {CharClass::PUNCT, TokenType::TOK_PLUS};
+        table['-'] = {CharClass::PUNCT, TokenType::TOK_MINUS};
+        table['*'] = {CharClass::PUNCT, TokenType::TOK_MUL_SIGN};
+        return table;
+    }();
+
+    [[nodiscard]] constexpr const CharInfo& char_info(const char c) {
+        return char_table[static_cast<unsigned char>(c)];
+    }
+
+    [[nodiscard]] constexpr bool is_ident_tail(const char c) {
+        const CharClass cls = char_info(c).cls;
+        return cls == CharClass::ALPHA || cls == CharClass::DIGIT;
+    }
+
+    /* Keyword perfect hash: length, first and last character mixed with a seed that the
+     * compiler searches for until every keyword lands in its own slot. */
+    inline constexpr std::size_t keyword_slots = 16;
+
+    [[nodiscard]] constexpr std::size_t keyword_hash(const std::string_view word, const std::uint32_t seed) {
+        const std::uint32_t first = static_cast<unsigned char>(word.front());
+        const std::uint32_t last = static_cast<unsigned char>(word.back());
+        const std::uint32_t mixed = (first * seed) ^ (last * (seed >> 7 | 1)) ^ (static_cast<std::uint32_t>(word.size()) * 0x9e37u);
+        return (mixed ^ (mixed >> 11)) & (keyword_slots - 1);
+    }
+
+    inline constexpr std::uint32_t keyword_seed = [] {
+        for (std::uint32_t seed = 1; seed < 1u << 20; seed++) {
+            std::array<bool, keyword_slots> used{};
+            bool collision = false;
+            for (const Keyword& keyword : keywords) {
+                const std::size_t slot = keyword_hash(keyword.word, seed);
+                collision |= used[slot];
+                used[slot] = true;
+            }
+            if (!collision)
+                return seed;
+        }
+        return 0u;
+    }();
+    static_assert(keyword_seed != 0, "No perfect hash seed for the keyword list, grow keyword_slots");
+
+    inline constexpr std::array<Keyword, keyword_slots> keyword_table = [] {
+        std::array<Keyword, keyword_slots> table{};
+        for (const Keyword& keyword : keywords)
+            table[keyword_hash(keyword.word, keyword_seed)] = keyword;
+        return table;
+    }();
+
+    /* One hash and at most one compare, regardless of how many keywords exist */
+    [[nodiscard]] constexpr std::optional<TokenType> lookup_keyword(const std::string_view word) {
+        const Keyword& candidate = keyword_table[keyword_hash(word, keyword_seed)];
+        if (candidate.word == word)
+            return candidate.ttype;
+        return {};
+    }
+
+    static_assert(lookup_keyword("print") == TokenType::TOK_PRINT);
+    static_assert(lookup_keyword("if") == TokenType::TOK_IF);
+    static_assert(lookup_keyword("import") == TokenType::TOK_IMPORT);
+    static_assert(!lookup_keyword("printer").has_value());
+}
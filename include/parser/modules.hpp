@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arena_alloc/arena.hpp>
+#include <main/file.hpp>
+#include <parser/parser.hpp>
+#include <parser/symbols.hpp>
+
+namespace HSharpParser {
+    class ThreadPool;
+
+    /* Resolves `import "path";` statements. Paths are relative to the importing file. Every
+     * module is tokenized and parsed as a task on a thread pool, into its own arena and symbol
+     * table, as soon as the first import of it has been parsed, so loading takes as long as
+     * the longest chain of imports rather than all modules in turn. Modules are keyed by
+     * canonical path: diamond imports parse a module once.
+     *
+     * Linking then splices each module in place of its first import, depth first, with
+     * symbols re-interned into the program's table; later imports of a module, including
+     * cyclic ones, are no-ops. */
+    class ModuleLoader {
+    private:
+        struct Module {
+            std::string path;
+            /* Set for imported modules; the root module's live with the caller */
+            std::optional<File> owned_file;
+            ArenaAllocator arena{64 * 1024};
+            SymbolTable owned_symbols;
+            std::optional<NodeProgram> owned_program;
+            const File* file = nullptr;
+            const NodeProgram* program = nullptr;
+            SymbolTable* symbols = nullptr;
+            /* Module index for each IMPORT statement, in statement order */
+            std::vector<std::size_t> imports;
+            /* Set by a parse task that hit a syntax error, for the main thread to report */
+            std::optional<SyntaxError> error;
+            bool linked = false;
+        };
+
+        ThreadPool& pool;
+        /* unique_ptr: tasks hold on to their module while the vector grows */
+        std::vector<std::unique_ptr<Module>> modules;
+        std::unordered_map<std::string, std::size_t> by_path;
+
+        /* Indices of modules whose parse task has finished, drained by load() */
+        std::mutex done_mutex;
+        std::condition_variable done_available;
+        std::vector<std::size_t> done;
+
+        static std::string canonical(const std::string& path);
+        /* Opens, tokenizes and parses module; runs on the pool, so it never exits */
+        void parse(Module& module);
+        /* Resolves module's imports, scheduling the ones not seen before; returns how many */
+        std::size_t schedule_imports(std::size_t index);
+        void link(std::size_t index, NodeProgram& out, SymbolTable& symbols);
+
+    public:
+        explicit ModuleLoader(ThreadPool& pool) : pool(pool) {}
+        ModuleLoader(const ModuleLoader&) = delete;
+        ModuleLoader& operator=(const ModuleLoader&) = delete;
+
+        [[nodiscard]] static bool has_imports(const NodeProgram& program);
+
+        /* Loads everything root (parsed from root_file with symbols) imports, transitively, and
+         * links it all into one import-free program whose ids are those of symbols. Empty, with
+         * the reason printed, if a module cannot be read or does not parse. */
+        std::optional<NodeProgram> load(const File& root_file, const NodeProgram& root, SymbolTable& symbols,
+                                        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        /* Distinct modules loaded, the root included */
+        [[nodiscard]] std::size_t module_count() const { return modules.size(); }
+    };
+}
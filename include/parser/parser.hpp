@@ -1,15 +1,20 @@
 #pragma once
 
+#include <array>
+#include <memory_resource>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <variant>
+#include <cinttypes>
 
 #include <main/file.hpp>
-#include <arena_alloc/arena.hpp>
+#include <parser/symbols.hpp>
 
 namespace HSharpParser {
-    enum class TokenType {
+    enum class TokenType : std::uint8_t {
         TOK_EXIT,
         TOK_VAR,
         TOK_PRINT,
@@ -27,142 +32,230 @@ namespace HSharpParser {
         TOK_CURLY_OPEN,
         TOK_CURLY_CLOSE,
         TOK_IDENT,
-        TOK_IF
+        TOK_IF,
+        TOK_IMPORT
     };
+    inline constexpr std::size_t token_type_count = static_cast<std::size_t>(TokenType::TOK_IMPORT) + 1;
 
+    /* Tokens do not own their text: offset/length address the source buffer the
+     * Tokenizer ran over, so that buffer must outlive every Token (the AST copies what
+     * it needs). Use text() to materialize a view of the lexeme. */
     struct Token {
         TokenType ttype{};
-        std::optional<std::string> value{};
-    };
+        std::uint32_t offset{};
+        std::uint32_t length{};
+        /* TOK_IDENT only: SymbolTable id and the name's hash */
+        std::uint32_t symbol{};
+        std::uint32_t hash{};
 
-    /* Forward declarations to allow any order of regular declarations */
-    struct NodeExpression;
-    struct NodeExpressionIdent;
-    struct NodeBinExpr;
-    struct NodeBinExprAdd;
-    struct NodeBinExprSub;
-    struct NodeBinExprMul;
-    struct NodeBinExprDiv;
-    struct NodeStmt;
-    struct NodeStmtExit;
-    struct NodeStmtInput;
-    struct NodeStmtPrint;
-    struct NodeStmtVar;
-    struct NodeTerm;
-    struct NodeTermIdent;
-    struct NodeTermIntLit;
-    struct NodeProgram;
-
-    /* Base nodes declarations */
-    struct NodeTermIntLit {
-        Token int_lit;
-    };
-    struct NodeTermIdent {
-        Token ident;
-    };
-    struct NodeExpressionStrLit {
-        Token str_lit;
+        [[nodiscard]] std::string_view text(std::string_view source) const {
+            return source.substr(offset, length);
+        }
     };
 
-    struct NodeBinExpr {
-        std::variant<NodeBinExprAdd*,
-                    NodeBinExprSub*,
-                    NodeBinExprMul*,
-                    NodeBinExprDiv*> var;
+    /* The AST is flat: every expression is a run of ExprNodes in postorder (operands before
+     * their operator), so evaluating one is a single forward sweep over contiguous memory
+     * with a value stack, and nodes refer to each other by position instead of pointer. */
+    enum class ExprKind : std::uint8_t {
+        INT_LIT,
+        IDENT,
+        STR_LIT,
+        ADD,
+        SUB,
+        MUL,
+        DIV
     };
 
-    struct NodeTerm {
-        std::variant<NodeTermIntLit*, NodeTermIdent*> term;
-    };
+    /* 12 bytes. INT_LIT: the value's low/high halves in a/b. IDENT: symbol id in a.
+     * STR_LIT: offset/length of the value in NodeProgram::string_data. Operators: operator
+     * token offset in a. */
+    struct ExprNode {
+        ExprKind kind{};
+        std::uint32_t a{};
+        std::uint32_t b{};
 
-    /* Basic expression node, includes all possible expressions */
-    struct NodeExpression {
-        std::variant<NodeTerm*, NodeExpressionStrLit*, NodeBinExpr*> expr;
+        [[nodiscard]] static ExprNode int_lit(const std::int64_t value) {
+            const auto bits = static_cast<std::uint64_t>(value);
+            return {ExprKind::INT_LIT, static_cast<std::uint32_t>(bits), static_cast<std::uint32_t>(bits >> 32)};
+        }
+        [[nodiscard]] std::int64_t int_value() const {
+            return static_cast<std::int64_t>(static_cast<std::uint64_t>(b) << 32 | a);
+        }
     };
+    static_assert(sizeof(ExprNode) == 12);
 
-    /* Binary expressions */
-    struct NodeBinExprAdd {
-        NodeExpression *lhs{}, *rhs{};
-    };
-    struct NodeBinExprSub {
-        NodeExpression *lhs{}, *rhs{};
-    };
-    struct NodeBinExprMul {
-        NodeExpression *lhs{}, *rhs{};
-    };
-    struct NodeBinExprDiv {
-        NodeExpression *lhs{}, *rhs{};
+    enum class StmtKind : std::uint8_t {
+        EXIT,
+        PRINT,
+        INPUT,
+        VAR,
+        ASSIGN,
+        IMPORT
     };
 
-    /* Statement nodes */
-    struct NodeExit {
-        NodeExpression* expr;
+    /* Every statement has one expression: NodeProgram::expressions[first, first + count).
+     * symbol is the assigned variable for VAR and ASSIGN. An IMPORT's expression is the single
+     * STR_LIT naming the module; ModuleLoader replaces imports when it links a program, so
+     * the VE never sees one. */
+    struct StmtNode {
+        StmtKind kind{};
+        std::uint32_t symbol{};
+        std::uint32_t first{};
+        std::uint32_t count{};
     };
-    struct NodeStmtExit {
-        NodeExpression* expr;
-    };
-    struct NodeStmtPrint {
-        NodeExpression* expr;
-    };
-    struct NodeStmtInput {
-        NodeExpression* expr;
-    };
-    struct NodeStmtVar {
-        Token ident{};
-        NodeExpression* expr{};
-    };
-    struct NodeStmtVarAssign {
-        Token ident{};
-        NodeExpression* expr{};
+
+    /* Source bytes covered by a top-level statement, from its first token through its ';' */
+    struct StatementSpan {
+        std::uint32_t begin;
+        std::uint32_t end;
     };
-    struct NodeStmt {
-        std::variant<NodeStmtExit*,
-                    NodeStmtPrint*,
-                    NodeStmtInput*,
-                    NodeStmtVar*,
-                    NodeStmtVarAssign*> statement;
+
+    /* Read-only, non-owning window onto a parsed program: what the VE runs. Backed either by
+     * a NodeProgram or directly by a mapped program image. */
+    struct ProgramView {
+        std::span<const StmtNode> statements;
+        std::span<const ExprNode> expressions;
+        std::string_view string_data;
+
+        [[nodiscard]] std::string_view string(const ExprNode& str_lit) const {
+            return string_data.substr(str_lit.a, str_lit.b);
+        }
     };
 
-    /* Start of AST */
+    /* Start of AST. Everything is stored by value or offset, never by pointer, so the program
+     * is position independent: it can be written out and mapped back as is. All arrays draw
+     * from the memory resource given at construction. */
     struct NodeProgram {
-        std::vector<NodeStmt*> statements;
+        std::pmr::vector<StmtNode> statements;
+        /* spans[i] belongs to statements[i] */
+        std::pmr::vector<StatementSpan> spans;
+        std::pmr::vector<ExprNode> expressions;
+        /* String literal values, back to back */
+        std::pmr::string string_data;
+
+        explicit NodeProgram(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : statements(resource), spans(resource), expressions(resource), string_data(resource) {}
+
+        [[nodiscard]] ProgramView view() const { return {statements, expressions, string_data}; }
     };
 
+    class ThreadPool;
+
+    /* What the tokenizer and parser throw on invalid source; what() is the diagnostic, location
+     * first. Command-line drivers print it and exit, IncrementalParser keeps going. */
+    class SyntaxError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /* Prints error to stderr and exits with status 1 */
+    [[noreturn]] void exit_on(const SyntaxError& error);
+
     class Tokenizer {
     private:
         File &file;
+        SymbolTable& symbols;
+        std::string_view source;
         std::uint32_t index = 0;
 
-        [[nodiscard]] std::optional<char> peek(int offset = 0) const;
-
-        char consume();
+        std::pmr::vector<Token> lex_parallel(ThreadPool& pool, std::size_t chunk_count, std::pmr::memory_resource* resource);
 
     public:
-        explicit Tokenizer(File &file) : file(file){}
+        /* Identifiers are interned into symbols as they are lexed */
+        Tokenizer(File &file, SymbolTable& symbols) : file(file), symbols(symbols), source(file.contents()) {}
+
+        [[nodiscard]] const File& source_file() const { return file; }
+
+        /* Lexes the next token into token; returns false once the source is exhausted */
+        bool next(Token& token);
+        /* Continues lexing from offset, which must lie between tokens */
+        void seek(const std::uint32_t offset) { index = offset; }
+        /* Sources below this size per chunk are not worth splitting across threads */
+        static constexpr std::size_t min_parallel_chunk = 1 << 20;
 
-        std::vector<Token> tokenize();
+        /* Drains next() into a vector, for consumers that need random access to all tokens */
+        std::pmr::vector<Token> tokenize(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+        /* Same result, token for token, with the source split into chunks lexed on pool */
+        std::pmr::vector<Token> tokenize(ThreadPool& pool,
+                                         std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     };
 
     class Parser {
     private:
-        const std::vector<Token> tokens;
+        /* Tokens are pulled from the tokenizer on demand into a small ring, so the parser never
+         * holds more than `lookahead` of them; peek() offsets must stay below it. */
+        static constexpr std::size_t lookahead = 4;
+        static_assert((lookahead & (lookahead - 1)) == 0, "lookahead must be a power of two");
+
+        Tokenizer& stream;
+        std::array<Token, lookahead> ring{};
+        std::size_t ring_head = 0;
+        std::size_t ring_count = 0;
+        /* Set when parsing tokens that were lexed ahead of time, e.g. in parallel */
+        std::optional<std::span<const Token>> pre_lexed;
         std::size_t index = 0;
-        ArenaAllocator allocator;
+        /* End offset of the last consumed token, closing each StatementSpan */
+        std::uint32_t consumed_end = 0;
+        /* parse_expression() operator stack, kept across calls to reuse its capacity */
+        std::vector<Token> operators;
+        std::size_t folded = 0;
+        std::size_t shared = 0;
 
-        [[nodiscard]] std::optional<Token> peek(int offset = 0) const;
+        /* Lookahead without copying: the token in place, or nullptr at end of input. The pointer
+         * is only good until the next consume() or peek(). */
+        [[nodiscard]] const Token* peek(int offset = 0);
+        [[nodiscard]] bool next_is(const TokenType type, const int offset = 0) {
+            const Token* token = peek(offset);
+            return token && token->ttype == type;
+        }
         Token try_consume(TokenType type, const char* err_msg);
         std::optional<Token> try_consume(TokenType type);
         Token consume();
+        /* Throws a SyntaxError for message at the current token (or at end of input) */
+        [[noreturn]] void fail(const char* message);
+        [[noreturn]] void fail(const char* message, std::uint32_t offset);
+
+        /* Dispatches on the statement's first token through statement_rules */
+        std::optional<StmtNode> parse_statement(NodeProgram& program);
+        /* One per leading token; each returns nothing, consuming nothing, if the tokens after it
+         * do not start its statement */
+        std::optional<StmtNode> parse_exit(NodeProgram& program);
+        std::optional<StmtNode> parse_print(NodeProgram& program);
+        std::optional<StmtNode> parse_input(NodeProgram& program);
+        std::optional<StmtNode> parse_var(NodeProgram& program);
+        std::optional<StmtNode> parse_assign(NodeProgram& program);
+        std::optional<StmtNode> parse_import(NodeProgram& program);
+        /* `keyword ( expression ) ;` */
+        std::optional<StmtNode> parse_call(NodeProgram& program, StmtKind kind, const char* invalid_expression);
 
-        std::optional<NodeStmt*> parse_statement();
-        std::optional<NodeExpression*> parse_expression();
-        std::optional<NodeBinExpr*> parse_bin_expr();
-        std::optional<NodeTerm*> parse_term();
+        using StatementRule = std::optional<StmtNode> (Parser::*)(NodeProgram&);
+        static const std::array<StatementRule, token_type_count> statement_rules;
+        /* Precedence climbing over an explicit operator stack, emitting nodes in postorder
+         * straight into program: no recursion, so expression length and parenthesis depth
+         * are bounded by memory, not the native stack. Sets first/count of stmt. */
+        bool parse_expression(NodeProgram& program, StmtNode& stmt);
+        bool parse_operand(NodeProgram& program);
+        /* Appends op, folding it with its operands into a single INT_LIT when both are integer
+         * literals of the expression starting at first */
+        void emit_operator(NodeProgram& program, std::uint32_t first, const Token& op);
 
     public:
-        explicit Parser(std::vector<Token> tokens) : tokens(std::move(tokens)), allocator(1024 * 1024 * 4) {}
+        explicit Parser(Tokenizer& stream) : stream(stream) {}
+        /* Parses tokens already produced by stream; the span must outlive the parser */
+        Parser(Tokenizer& stream, std::span<const Token> tokens) : stream(stream), pre_lexed(tokens) {}
+
+        /* Parses one top-level statement, appending its expression nodes and string data to
+         * program (but not the statement itself) and recording its span; empty at end of input */
+        std::optional<StmtNode> next_statement(NodeProgram& program, StatementSpan& span);
+        /* With deduplicate, statements whose whole expressions are identical share their nodes
+         * (subexpressions are not interned) and identical string literals share their text; the
+         * program is then a DAG and must not be edited in place (IncrementalParser never asks for it) */
+        std::optional<NodeProgram> parse_program(std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+                                                 bool deduplicate = false);
 
-        std::optional<NodeProgram> parse_program();
+        /* Operators folded into constants so far */
+        [[nodiscard]] std::size_t folded_constants() const { return folded; }
+        /* Statements parse_program() pointed at an earlier statement's nodes */
+        [[nodiscard]] std::size_t shared_expressions() const { return shared; }
     };
-    class ArenaAllocator;
 }
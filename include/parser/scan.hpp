@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string_view>
+
+/* Run-scanning kernels used by the Tokenizer. Every kernel returns the first position in
+ * [cursor, end) that ends the run (or end). The implementation is picked once at startup:
+ * AVX2 when the CPU supports it, SSE2 on any other x86-64, plain scalar code elsewhere. */
+namespace HSharpParser::Scan {
+    /* Skips ' ', '\t', '\n', '\v', '\f' and '\r' */
+    [[nodiscard]] const char* skip_whitespace(const char* cursor, const char* end);
+    /* Skips [A-Za-z0-9] */
+    [[nodiscard]] const char* skip_ident_tail(const char* cursor, const char* end);
+    /* Skips [0-9] */
+    [[nodiscard]] const char* skip_digits(const char* cursor, const char* end);
+    /* Finds the first occurrence of byte */
+    [[nodiscard]] const char* find_byte(const char* cursor, const char* end, char byte);
+    /* Counts occurrences of byte */
+    [[nodiscard]] std::size_t count_byte(const char* cursor, const char* end, char byte);
+    /* Finds the opening asterisk of the first block comment terminator */
+    [[nodiscard]] const char* find_comment_close(const char* cursor, const char* end);
+
+    /* Name of the kernel set in use: "avx2", "sse2" or "scalar" */
+    [[nodiscard]] std::string_view active_kernels();
+    /* Switches to the named kernel set; returns false if it is unknown or unsupported here */
+    bool select_kernels(std::string_view name);
+}
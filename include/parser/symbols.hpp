@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <arena_alloc/arena.hpp>
+
+namespace HSharpParser {
+    /* Interns identifier names into dense ids, assigned in first-seen order starting at 0.
+     * Names are copied into table-owned storage, so ids and name() views stay valid after the
+     * source buffer is gone. */
+    class SymbolTable {
+    private:
+        struct Entry {
+            std::string_view name;
+            std::uint32_t hash;
+        };
+
+        std::vector<Entry> entries;
+        /* Open addressing over entries, storing id + 1 so that 0 marks an empty slot */
+        std::vector<std::uint32_t> slots = std::vector<std::uint32_t>(64);
+        /* Name bytes; chunks never move, so views into them stay valid as the table grows */
+        ArenaAllocator names;
+
+        std::string_view store(std::string_view name);
+        void grow();
+
+    public:
+        SymbolTable() = default;
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+        SymbolTable(SymbolTable&&) = default;
+        SymbolTable& operator=(SymbolTable&&) = default;
+
+        /* Word-at-a-time multiplicative hash; the tokenizer computes it once per identifier */
+        [[nodiscard]] static std::uint32_t hash(std::string_view name) {
+            std::uint64_t state = 0x9e3779b97f4a7c15ull ^ name.size();
+            std::size_t i = 0;
+            for (; i + 8 <= name.size(); i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, name.data() + i, 8);
+                state = (state ^ word) * 0xff51afd7ed558ccdull;
+                state ^= state >> 32;
+            }
+            std::uint64_t tail = 0;
+            std::memcpy(&tail, name.data() + i, name.size() - i);
+            state = (state ^ tail) * 0xc4ceb9fe1a85ec53ull;
+            state ^= state >> 29;
+            return static_cast<std::uint32_t>(state);
+        }
+
+        std::uint32_t intern(std::string_view name, std::uint32_t hash);
+        std::uint32_t intern(const std::string_view name) { return intern(name, hash(name)); }
+        [[nodiscard]] std::optional<std::uint32_t> find(std::string_view name) const;
+
+        [[nodiscard]] std::string_view name(const std::uint32_t id) const { return entries[id].name; }
+        [[nodiscard]] std::size_t size() const { return entries.size(); }
+    };
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace HSharpParser {
+    /* Fixed-size pool of worker threads draining a FIFO of tasks. Destruction waits for the
+     * queue to drain and joins every worker. */
+    class ThreadPool {
+    private:
+        std::vector<std::jthread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable available;
+        bool stopping = false;
+
+        inline void work() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(mutex);
+                    available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty())
+                        return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+    public:
+        inline explicit ThreadPool(std::size_t threads) {
+            if (threads == 0)
+                threads = 1;
+            workers.reserve(threads);
+            for (std::size_t i = 0; i < threads; i++)
+                workers.emplace_back([this] { work(); });
+        }
+        inline ThreadPool(const ThreadPool&) = delete;
+        inline ThreadPool& operator=(const ThreadPool&) = delete;
+        inline ~ThreadPool() {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            available.notify_all();
+            /* Join here, while the queue and its lock are still alive */
+            workers.clear();
+        }
+
+        [[nodiscard]] inline std::size_t size() const { return workers.size(); }
+
+        template<typename F>
+        inline std::future<std::invoke_result_t<F>> submit(F&& function) {
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(function));
+            auto result = task->get_future();
+            {
+                std::lock_guard lock(mutex);
+                tasks.emplace_back([task] { (*task)(); });
+            }
+            available.notify_one();
+            return result;
+        }
+    };
+}
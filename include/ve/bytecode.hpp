@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include <parser/parser.hpp>
+#include <parser/symbols.hpp>
+#include <ve/value.hpp>
+
+/* Register bytecode ("IB") for the VM engine. Operands of arithmetic and of the statement
+ * instructions are slot indices into one flat value file: the constant pool comes first,
+ * followed by the registers, so an operand never needs to say which of the two it names.
+ * Registers are allocated by expression stack depth, so a statement uses at most as many
+ * registers as its expression is deep, and literals cost no instruction at all. */
+namespace HSharpVE {
+    class JitCode;
+
+    enum class Opcode : std::uint8_t {
+        /* slot a = global b; fails if b is undeclared */
+        LOAD_GLOBAL,
+        /* slot a = slot b op slot c */
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        /* Fail unless global a is undeclared (var) or declared (assignment) */
+        CHECK_UNDECLARED,
+        CHECK_DECLARED,
+        /* global a = slot b */
+        STORE_GLOBAL,
+        PRINT,
+        EXIT,
+        INPUT,
+        /* Superinstructions, one per fused statement shape (see ve/shapes.hpp):
+         * global a += slot b, failing unless a is declared; */
+        ADD_GLOBAL,
+        /* print global a; */
+        PRINT_GLOBAL,
+        /* declare global a as slot b */
+        DECLARE,
+        HALT
+    };
+    inline constexpr std::size_t opcode_count = static_cast<std::size_t>(Opcode::HALT) + 1;
+
+    struct Instruction {
+        Opcode op{};
+        std::uint32_t a{};
+        std::uint32_t b{};
+        std::uint32_t c{};
+    };
+
+    struct BytecodeProgram {
+        std::pmr::vector<Instruction> code;
+        std::pmr::vector<Value> constants;
+        std::uint32_t register_count = 0;
+        /* Statements compiled to a single superinstruction */
+        std::size_t fused = 0;
+        /* What string values slice */
+        std::string_view string_data;
+
+        explicit BytecodeProgram(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : code(resource), constants(resource) {}
+    };
+
+    /* Translates a whole program; constants are interned, so a literal repeated across the
+     * program occupies one pool entry */
+    [[nodiscard]] BytecodeProgram compile(HSharpParser::ProgramView program,
+                                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /* Runs a BytecodeProgram to the end or to exit(). Behaviour, output and error messages
+     * match VirtualEnvironment statement for statement. */
+    class BytecodeVM {
+    private:
+        const BytecodeProgram& program;
+        const HSharpParser::SymbolTable& symbols;
+        /* Constant pool, then registers */
+        std::pmr::vector<Value> slots;
+        std::pmr::vector<Value> globals;
+
+    public:
+        /* program and symbols must outlive the VM */
+        BytecodeVM(const BytecodeProgram& program, const HSharpParser::SymbolTable& symbols,
+                   std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : program(program), symbols(symbols), slots(resource), globals(resource) {}
+
+        /* With jit, runs its machine code first and interprets from wherever that leaves off */
+        void run(const JitCode* jit = nullptr);
+    };
+}
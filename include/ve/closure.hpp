@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include <parser/parser.hpp>
+#include <parser/symbols.hpp>
+#include <ve/value.hpp>
+
+/* Closure-compiled engine: every expression is translated once into a tree of function-pointer
+ * nodes, each specialized for its operator and for the shape of both operands (a constant held
+ * in the node, a global read in place, or another node). Evaluating one is a chain of direct
+ * calls, with no dispatch on node kinds and no operand stack.
+ *
+ * Nodes quicken: operand types that are known when the node is built (constants, and other
+ * nodes, which always yield integers) are never checked at run time, and a node reading a
+ * global rewrites itself into the unchecked integer form the first time it evaluates, which
+ * it can only do on integers. The compiler lists the nodes reading each global; assigning a
+ * global a value of another type deoptimizes the nodes on its list, and only those, back to
+ * their checked form. */
+namespace HSharpVE {
+    struct ExprClosure;
+    struct StmtClosure;
+    struct ClosureProgram;
+
+    struct ClosureState {
+        Value* globals = nullptr;
+        HSharpParser::ProgramView source;
+        /* Operand stack of the expressions too deep to be closures */
+        std::pmr::vector<Value> stack;
+        /* Whose nodes quicken and are deoptimized */
+        ClosureProgram* program = nullptr;
+        std::size_t deoptimizations = 0;
+    };
+
+    using ExprFunction = Value (*)(ExprClosure& self, ClosureState& state);
+    using StmtFunction = void (*)(const StmtClosure& self, ClosureState& state);
+
+    /* Which member is live is fixed by the function the operand is passed to */
+    union ClosureOperand {
+        ExprClosure* node;
+        std::uint32_t symbol;
+        Value constant;
+
+        ClosureOperand() : constant() {}
+    };
+
+    struct ExprClosure {
+        ExprFunction eval = nullptr;
+        /* What eval is reset to on deoptimization: its form before any quickening */
+        ExprFunction entry = nullptr;
+        ClosureOperand left;
+        ClosureOperand right;
+    };
+
+    struct StmtClosure {
+        StmtFunction exec = nullptr;
+        ClosureOperand value;
+        std::uint32_t symbol = 0;
+    };
+
+    struct ClosureProgram {
+        /* Never reallocated once built; closures point into it. Quickening rewrites them while
+         * the program runs. */
+        std::pmr::vector<ExprClosure> expressions;
+        std::pmr::vector<StmtClosure> statements;
+        HSharpParser::ProgramView source;
+        /* The checked nodes reading each global, by index into expressions: those reading
+         * symbol s are readers[reader_offsets[s]] up to readers[reader_offsets[s + 1]]. Symbols
+         * past the end of reader_offsets are read by none. */
+        std::pmr::vector<std::uint32_t> reader_offsets;
+        std::pmr::vector<std::uint32_t> readers;
+        /* Statements whose expression nests too deep to recurse on and is swept instead */
+        std::size_t swept = 0;
+        /* Statements fused into a single closure of their own shape */
+        std::size_t fused = 0;
+
+        explicit ClosureProgram(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : expressions(resource), statements(resource), reader_offsets(resource), readers(resource) {}
+    };
+
+    /* Expression runs shared through hash-consing are compiled once */
+    [[nodiscard]] ClosureProgram compile_closures(HSharpParser::ProgramView program,
+                                                  std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /* Runs a ClosureProgram to the end or to exit(), matching VirtualEnvironment in behaviour,
+     * output and error messages */
+    class ClosureEngine {
+    private:
+        ClosureProgram& program;
+        const HSharpParser::SymbolTable& symbols;
+        std::pmr::vector<Value> globals;
+        ClosureState state;
+
+    public:
+        /* program and symbols must outlive the engine */
+        ClosureEngine(ClosureProgram& program, const HSharpParser::SymbolTable& symbols,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : program(program), symbols(symbols), globals(resource),
+              state{.stack = std::pmr::vector<Value>(resource)} {}
+
+        /* Starts from unquickened closures, so engines can take turns running one program */
+        void run();
+        /* Nodes currently in their quickened form */
+        [[nodiscard]] std::size_t quickened_count() const;
+        [[nodiscard]] std::size_t deoptimization_count() const { return state.deoptimizations; }
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <ve/bytecode.hpp>
+#include <ve/value.hpp>
+
+/* Baseline template JIT, Linux x86-64 only: every bytecode instruction becomes a fixed
+ * machine-code template working on the VM's own slots and globals, with print() and exit()
+ * calling into the runtime. Programs are straight-line and every global starts out undeclared,
+ * so the type of every slot and global is known at each instruction while compiling, and
+ * type checks are resolved there instead of in the code. Integers at the shallowest expression
+ * depths stay in machine registers, and loads of globals read the global in place, until the
+ * statement consumes them or the code returns.
+ *
+ * Whatever the code cannot do itself (a check known to fail, a division by zero, input())
+ * makes it return the index of that instruction, and BytecodeVM interprets the rest from
+ * there on the same state, raising the same errors. Code pages are written, then made
+ * executable, never both (W^X). */
+namespace HSharpVE {
+    class JitCode {
+    private:
+        void* mapping = nullptr;
+        std::size_t mapping_size = 0;
+        std::size_t code_size = 0;
+        /* Instructions compiled before the first one the code always returns at */
+        std::size_t compiled = 0;
+
+        JitCode() = default;
+
+    public:
+        JitCode(const JitCode&) = delete;
+        JitCode& operator=(const JitCode&) = delete;
+        JitCode(JitCode&& other) noexcept;
+        JitCode& operator=(JitCode&& other) noexcept;
+        ~JitCode();
+
+        /* Empty on other platforms, if the program is too large to address with 32-bit
+         * displacements, or if executable memory cannot be had */
+        static std::optional<JitCode> compile(const BytecodeProgram& program, std::size_t global_count);
+
+        /* Runs from the first instruction with slots and globals laid out as BytecodeVM does;
+         * returns the index of the instruction to go on interpreting at */
+        std::uint32_t run(Value* slots, Value* globals, std::string_view string_data) const;
+
+        [[nodiscard]] std::size_t size() const { return code_size; }
+        [[nodiscard]] std::size_t compiled_instructions() const { return compiled; }
+    };
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+#include <parser/parser.hpp>
+
+/* Statement shapes common enough for the compiled engines to fuse each into a single
+ * instruction or closure, and the profile used to find them */
+namespace HSharpVE {
+    enum class StatementShape : std::uint8_t {
+        GENERIC,
+        /* x = x + <int>; and x = x - <int>; */
+        UPDATE,
+        /* print(<ident>); */
+        PRINT_GLOBAL,
+        /* var x = <literal>; */
+        DECLARE_CONSTANT
+    };
+
+    struct FusedStatement {
+        StatementShape shape = StatementShape::GENERIC;
+        /* UPDATE: what is added, negated for a subtraction. Wrapping makes the two the same. */
+        std::int64_t addend = 0;
+        /* PRINT_GLOBAL: the identifier; DECLARE_CONSTANT: the literal */
+        const HSharpParser::ExprNode* operand = nullptr;
+    };
+
+    [[nodiscard]] FusedStatement match_shape(HSharpParser::ProgramView program, const HSharpParser::StmtNode& stmt);
+
+    /* Counts n-grams of node shapes within statements: each statement is its expression nodes
+     * in postorder followed by the statement node itself, and an identifier naming the
+     * statement's own target is told apart from other identifiers. Programs have no loops, so
+     * static counts are execution counts, but for statements an exit() or an error never reaches. */
+    class ShapeProfile {
+    private:
+        std::array<std::unordered_map<std::string, std::size_t>, 4> grams;
+        std::size_t statements = 0;
+
+    public:
+        static constexpr std::size_t max_gram = 4;
+
+        void add(HSharpParser::ProgramView program);
+        /* The top most frequent n-grams for every n */
+        void report(std::FILE* out, std::size_t top) const;
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cinttypes>
+#include <string_view>
+
+#include <parser/parser.hpp>
+#include <ve/exceptions.hpp>
+
+/* Runtime values of the compiled engines (bytecode and closures), and the semantics they
+ * share with VirtualEnvironment, so that every engine behaves and fails the same way */
+namespace HSharpVE {
+    enum class ValueType : std::uint8_t {
+        /* A global that was never declared */
+        UNDEFINED,
+        INT,
+        STRING
+    };
+
+    /* 16 bytes, held by value. Strings are immutable and every string value is some literal,
+     * so one is just a slice of the program's string data. */
+    struct Value {
+        ValueType type = ValueType::UNDEFINED;
+        union {
+            std::int64_t integer;
+            struct {
+                std::uint32_t offset;
+                std::uint32_t length;
+            } text;
+        };
+
+        Value() : integer(0) {}
+        [[nodiscard]] static Value make_int(const std::int64_t value) {
+            Value result;
+            result.type = ValueType::INT;
+            result.integer = value;
+            return result;
+        }
+        [[nodiscard]] static Value make_string(const std::uint32_t offset, const std::uint32_t length) {
+            Value result;
+            result.type = ValueType::STRING;
+            result.text = {offset, length};
+            return result;
+        }
+    };
+    static_assert(sizeof(Value) == 16);
+
+    /* Reading an undeclared global */
+    [[noreturn]] void fail_undefined_identifier();
+    /* Declaring a global twice */
+    [[noreturn]] void fail_redeclaration();
+    void print_value(const Value& value, std::string_view string_data);
+    [[noreturn]] void exit_with_value(const Value& value, std::string_view string_data);
+
+    /* Integer arithmetic on operands known to be integers, for every engine; overflow wraps
+     * around in two's complement, INT64_MIN / -1 included */
+    template<HSharpParser::ExprKind kind>
+    [[nodiscard]] inline std::int64_t integer_arithmetic(const std::int64_t left, const std::int64_t right) {
+        using HSharpParser::ExprKind;
+        const auto l = static_cast<std::uint64_t>(left);
+        const auto r = static_cast<std::uint64_t>(right);
+        if constexpr (kind == ExprKind::ADD) {
+            return static_cast<std::int64_t>(l + r);
+        } else if constexpr (kind == ExprKind::SUB) {
+            return static_cast<std::int64_t>(l - r);
+        } else if constexpr (kind == ExprKind::MUL) {
+            return static_cast<std::int64_t>(l * r);
+        } else {
+            static_assert(kind == ExprKind::DIV);
+            if (right == 0) [[unlikely]]
+                throwFatalVirtualEnvException("Binary expression evaluation impossible: division by zero");
+            /* The one quotient that overflows, which idiv traps on */
+            if (right == -1) [[unlikely]]
+                return static_cast<std::int64_t>(0 - l);
+            return left / right;
+        }
+    }
+
+    /* integer_arithmetic, failing unless both operands are integers */
+    template<HSharpParser::ExprKind kind>
+    [[nodiscard]] inline Value arithmetic(const Value& left, const Value& right) {
+        if (left.type != ValueType::INT || right.type != ValueType::INT) [[unlikely]]
+            throwFatalVirtualEnvException("Binary expression evaluation impossible: invalid literal type");
+        return Value::make_int(integer_arithmetic<kind>(left.integer, right.integer));
+    }
+}
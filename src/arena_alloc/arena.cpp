@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <arena_alloc/arena.hpp>
+
+HSharpParser::ArenaAllocator::ArenaAllocator(ArenaAllocator&& other) noexcept
+    : current(std::exchange(other.current, nullptr)),
+      spare(std::exchange(other.spare, nullptr)),
+      cursor(std::exchange(other.cursor, nullptr)),
+      limit(std::exchange(other.limit, nullptr)),
+      next_chunk_size(other.next_chunk_size),
+      guard_pages(other.guard_pages),
+      counters(std::exchange(other.counters, {})),
+      retired_used(std::exchange(other.retired_used, 0)) {}
+
+HSharpParser::ArenaAllocator& HSharpParser::ArenaAllocator::operator=(ArenaAllocator&& other) noexcept {
+    if (this != &other) {
+        free_chunks_after(nullptr);
+        free_spares();
+        current = std::exchange(other.current, nullptr);
+        spare = std::exchange(other.spare, nullptr);
+        cursor = std::exchange(other.cursor, nullptr);
+        limit = std::exchange(other.limit, nullptr);
+        next_chunk_size = other.next_chunk_size;
+        guard_pages = other.guard_pages;
+        counters = std::exchange(other.counters, {});
+        retired_used = std::exchange(other.retired_used, 0);
+    }
+    return *this;
+}
+
+HSharpParser::ArenaAllocator::~ArenaAllocator() {
+    free_chunks_after(nullptr);
+    free_spares();
+}
+
+void HSharpParser::ArenaAllocator::fail(const char* message) {
+    std::cerr << message << std::endl;
+    exit(1);
+}
+
+void HSharpParser::ArenaAllocator::add_chunk(const std::size_t min_bytes) {
+    for (Chunk** link = &spare; *link; link = &(*link)->previous) {
+        if ((*link)->size < min_bytes)
+            continue;
+        Chunk* chunk = *link;
+        *link = chunk->previous;
+        push_chunk(chunk);
+        return;
+    }
+
+    const std::size_t size = std::max(next_chunk_size, min_bytes);
+    if (size > SIZE_MAX / 2)
+        fail("ArenaAllocator: allocation size overflows");
+    Chunk* chunk;
+    std::size_t mapped = 0;
+    if (guard_pages) {
+        const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        /* Usable bytes end exactly at the guard page, so overruns fault on the first byte */
+        const std::size_t usable = (sizeof(Chunk) + size + page - 1) / page * page;
+        mapped = usable + page;
+        void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            fail("ArenaAllocator failed to allocate memory: mmap() failed");
+        if (mprotect(static_cast<char*>(memory) + usable, page, PROT_NONE) != 0) {
+            munmap(memory, mapped);
+            fail("ArenaAllocator failed to allocate memory: mprotect() of the guard page failed");
+        }
+        chunk = static_cast<Chunk*>(memory);
+        chunk->size = usable - sizeof(Chunk);
+    } else {
+        chunk = static_cast<Chunk*>(std::malloc(sizeof(Chunk) + size));
+        if (!chunk)
+            fail("ArenaAllocator failed to allocate memory: malloc() returned null");
+        chunk->size = size;
+    }
+    chunk->mapped = mapped;
+    counters.chunks++;
+    counters.bytes_reserved += chunk->size;
+    next_chunk_size = std::min(next_chunk_size * 2, max_chunk_size);
+    push_chunk(chunk);
+}
+
+void HSharpParser::ArenaAllocator::push_chunk(Chunk* chunk) {
+    if (current)
+        retired_used += static_cast<std::size_t>(cursor - current->begin());
+    chunk->previous = current;
+    current = chunk;
+    cursor = chunk->begin();
+    limit = cursor + chunk->size;
+}
+
+void* HSharpParser::ArenaAllocator::allocate_slow(const std::size_t bytes, const std::size_t alignment) {
+    if (bytes > SIZE_MAX - alignment)
+        fail("ArenaAllocator: allocation size overflows");
+    /* The chunk header keeps begin() max_align_t-aligned; larger alignments need slack */
+    add_chunk(bytes + (alignment > alignof(std::max_align_t) ? alignment : 0));
+    return allocate_bytes(bytes, alignment);
+}
+
+void HSharpParser::ArenaAllocator::free_chunk(Chunk* chunk) {
+    counters.chunks--;
+    counters.bytes_reserved -= chunk->size;
+    if (chunk->mapped)
+        munmap(chunk, chunk->mapped);
+    else
+        std::free(chunk);
+}
+
+void HSharpParser::ArenaAllocator::free_chunks_after(const Chunk* keep) {
+    while (current != keep) {
+        Chunk* previous = current->previous;
+        free_chunk(current);
+        current = previous;
+    }
+}
+
+void HSharpParser::ArenaAllocator::release(const Mark& mark) {
+    free_chunks_after(mark.chunk);
+    cursor = mark.cursor;
+    limit = current ? current->begin() + current->size : nullptr;
+    counters.allocations = mark.allocations;
+    retired_used = mark.retired_used;
+}
+
+void HSharpParser::ArenaAllocator::free_spares() {
+    while (spare) {
+        Chunk* next = spare->previous;
+        free_chunk(spare);
+        spare = next;
+    }
+}
+
+void HSharpParser::ArenaAllocator::reset() {
+    while (current) {
+        Chunk* previous = current->previous;
+        current->previous = spare;
+        spare = current;
+        current = previous;
+    }
+    cursor = limit = nullptr;
+    counters.allocations = 0;
+    retired_used = 0;
+}
+
+HSharpParser::ArenaStats HSharpParser::ArenaAllocator::stats() const {
+    ArenaStats result = counters;
+    result.bytes_used = retired_used + (current ? static_cast<std::size_t>(cursor - current->begin()) : 0);
+    return result;
+}
@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <version.hpp>
+#include <arena_alloc/arena.hpp>
+#include <bench/generator.hpp>
+#include <parser/parser.hpp>
+#include <parser/incremental.hpp>
+#include <parser/scan.hpp>
+#include <main/compilation.hpp>
+#include <main/file.hpp>
+#include <thread_pool/thread_pool.hpp>
+#include <ve/bytecode.hpp>
+#include <ve/closure.hpp>
+#include <ve/jit.hpp>
+#include <ve/ve.hpp>
+#include <argparse/argparse.hpp>
+
+using HSharpParser::Token;
+
+/* Every operator new in the process is counted, so each phase reports how many heap
+ * allocations it made; vectors and boost pools show up only when they grow. */
+namespace {
+    std::atomic<std::size_t> allocation_count{0};
+    std::atomic<std::size_t> allocated_bytes{0};
+}
+
+/* The replacements stay out of line: inlined into a caller, GCC would see the free() below
+ * paired with a new-expression and report -Wmismatched-new-delete */
+[[gnu::noinline]] void* operator new(const std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](const std::size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+struct Phase {
+    double seconds = 0;
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+    /* Process-wide high-water mark once the phase finished */
+    long peak_rss_kib = 0;
+};
+
+template<typename Body>
+static Phase measure(Body&& body) {
+    const std::size_t allocations = allocation_count.load();
+    const std::size_t bytes = allocated_bytes.load();
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return {
+        .seconds = elapsed.count(),
+        .allocations = allocation_count.load() - allocations,
+        .bytes = allocated_bytes.load() - bytes,
+        .peak_rss_kib = usage.ru_maxrss
+    };
+}
+
+/* The programs print a lot; measure() with stdout sent to /dev/null keeps that off the JSON */
+template<typename Body>
+static Phase measure_quietly(Body&& body) {
+    std::fflush(stdout);
+    const int saved_stdout = dup(STDOUT_FILENO);
+    const int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    dup2(null_fd, STDOUT_FILENO);
+    const Phase phase = measure([&] {
+        body();
+        std::fflush(stdout);
+    });
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(null_fd);
+    close(saved_stdout);
+    return phase;
+}
+
+/* Everything body writes to stdout */
+template<typename Body>
+static std::string capture_output(Body&& body) {
+    std::fflush(stdout);
+    std::FILE* file = std::tmpfile();
+    const int saved_stdout = dup(STDOUT_FILENO);
+    dup2(fileno(file), STDOUT_FILENO);
+    body();
+    std::fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    std::string output;
+    std::rewind(file);
+    char buffer[65536];
+    while (const std::size_t read = std::fread(buffer, 1, sizeof(buffer), file))
+        output.append(buffer, read);
+    std::fclose(file);
+    return output;
+}
+
+/* Keeps the fastest run's time and the latest run's counters */
+static void keep_best(Phase& best, const Phase& run) {
+    const double seconds = best.seconds ? std::min(best.seconds, run.seconds) : run.seconds;
+    best = run;
+    best.seconds = seconds;
+}
+
+static void print_phase(const char* name, const Phase& phase, const double megabytes, const std::size_t tokens,
+                        const std::size_t statements, const bool last) {
+    std::printf("      \"%s\": {\"seconds\": %.6f, \"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, \"statements_per_s\": %.0f, "
+                "\"allocations\": %zu, \"allocated_bytes\": %zu, \"peak_rss_kib\": %ld}%s\n",
+                name, phase.seconds, megabytes / phase.seconds, static_cast<double>(tokens) / phase.seconds,
+                static_cast<double>(statements) / phase.seconds, phase.allocations, phase.bytes, phase.peak_rss_kib,
+                last ? "" : ",");
+}
+
+/* Tokenize, parse and run one generated program, on the tree walker, as bytecode, as closures and JIT-compiled, each
+ * phase timed on its own; false if the engines' outputs differ, or if a workload built for
+ * quickening never quickened. Like hve_ng, the front end allocates from an arena and the VE
+ * from a pool on top of it, unless use_arena is off; arena chunks are malloc()ed and so are
+ * reported separately. */
+static bool bench_workload(const HSharpBench::Workload workload, const std::size_t statements, const int iterations,
+                           const bool use_arena, const bool deduplicate, const bool last) {
+    File source_file(HSharpBench::generate(workload, statements));
+    const double megabytes = static_cast<double>(source_file.size()) / 1e6;
+    Phase tokenize, parse, run, compile, run_bytecode, compile_closures, run_closures, compile_jit, run_jit;
+    bool engines_match = false;
+    std::size_t quickened = 0, deoptimizations = 0, fused = 0;
+    std::size_t token_count = 0, statement_count = 0, node_count = 0, string_bytes = 0;
+    HSharpParser::ArenaStats arena_stats;
+    /* Reused across iterations the way a long-lived host would reuse it across compilations */
+    HSharpParser::ArenaAllocator arena(1024 * 1024);
+    for (int i = 0; i < iterations; i++) {
+        arena.reset();
+        std::pmr::memory_resource* resource = use_arena ? &arena : std::pmr::get_default_resource();
+        HSharpParser::SymbolTable symbols;
+        HSharpParser::Tokenizer tokenizer(source_file, symbols);
+        /* On the same resource as tokenize() allocates from, so that the assignment moves the buffer
+         * rather than copying every token onto the heap inside the timed phase */
+        std::pmr::vector<Token> tokens(resource);
+        keep_best(tokenize, measure([&] { tokens = tokenizer.tokenize(resource); }));
+        token_count = tokens.size();
+
+        HSharpParser::Parser parser(tokenizer, tokens);
+        std::optional<HSharpParser::NodeProgram> program;
+        keep_best(parse, measure([&] {
+            program = parser.parse_program(resource, deduplicate || HSharpBench::needs_deduplication(workload));
+        }));
+        statement_count = program.value().statements.size();
+        node_count = program.value().expressions.size();
+        string_bytes = program.value().string_data.size();
+
+        std::pmr::unsynchronized_pool_resource runtime_memory(resource);
+        HSharpVE::VirtualEnvironment ve(program.value().view(), symbols, false, &runtime_memory);
+        keep_best(run, measure_quietly([&] { ve.run(); }));
+
+        std::optional<HSharpVE::BytecodeProgram> bytecode;
+        keep_best(compile, measure([&] { bytecode = HSharpVE::compile(program.value().view(), resource); }));
+        fused = bytecode.value().fused;
+        HSharpVE::BytecodeVM vm(bytecode.value(), symbols, &runtime_memory);
+        keep_best(run_bytecode, measure_quietly([&] { vm.run(); }));
+
+        std::optional<HSharpVE::ClosureProgram> closures;
+        keep_best(compile_closures, measure([&] { closures = HSharpVE::compile_closures(program.value().view(), resource); }));
+        HSharpVE::ClosureEngine closure_engine(closures.value(), symbols, &runtime_memory);
+        keep_best(run_closures, measure_quietly([&] { closure_engine.run(); }));
+        quickened = closure_engine.quickened_count();
+        deoptimizations = closure_engine.deoptimization_count();
+
+        /* Falls back to interpreting where there is no JIT, like hve_ng */
+        std::optional<HSharpVE::JitCode> jit;
+        keep_best(compile_jit, measure([&] { jit = HSharpVE::JitCode::compile(bytecode.value(), symbols.size()); }));
+        const HSharpVE::JitCode* jit_code = jit ? &*jit : nullptr;
+        HSharpVE::BytecodeVM jit_vm(bytecode.value(), symbols, &runtime_memory);
+        keep_best(run_jit, measure_quietly([&] { jit_vm.run(jit_code); }));
+
+        if (i == 0) {
+            /* Untimed: every engine again, on fresh state, with their output compared */
+            HSharpVE::VirtualEnvironment reference(program.value().view(), symbols, false, &runtime_memory);
+            HSharpVE::BytecodeVM candidate(bytecode.value(), symbols, &runtime_memory);
+            HSharpVE::ClosureEngine closure_candidate(closures.value(), symbols, &runtime_memory);
+            HSharpVE::BytecodeVM jit_candidate(bytecode.value(), symbols, &runtime_memory);
+            const std::string expected = capture_output([&] { reference.run(); });
+            engines_match = expected == capture_output([&] { candidate.run(); })
+                            && expected == capture_output([&] { closure_candidate.run(); })
+                            && expected == capture_output([&] { jit_candidate.run(jit_code); });
+        }
+        arena_stats = arena.stats();
+    }
+
+    std::printf("    {\"name\": \"%.*s\", \"bytes\": %llu, \"tokens\": %zu, \"statements\": %zu,\n",
+                static_cast<int>(HSharpBench::workload_name(workload).size()), HSharpBench::workload_name(workload).data(),
+                static_cast<unsigned long long>(source_file.size()), token_count, statement_count);
+    std::printf("      \"ast\": {\"expression_nodes\": %zu, \"string_bytes\": %zu},\n", node_count, string_bytes);
+    std::printf("      \"arena\": {\"chunks\": %zu, \"bytes_used\": %zu, \"bytes_reserved\": %zu},\n",
+                arena_stats.chunks, arena_stats.bytes_used, arena_stats.bytes_reserved);
+    print_phase("tokenize", tokenize, megabytes, token_count, statement_count, false);
+    print_phase("parse", parse, megabytes, token_count, statement_count, false);
+    print_phase("run", run, megabytes, token_count, statement_count, false);
+    print_phase("compile_bytecode", compile, megabytes, token_count, statement_count, false);
+    print_phase("run_bytecode", run_bytecode, megabytes, token_count, statement_count, false);
+    print_phase("compile_closures", compile_closures, megabytes, token_count, statement_count, false);
+    print_phase("run_closures", run_closures, megabytes, token_count, statement_count, false);
+    print_phase("compile_jit", compile_jit, megabytes, token_count, statement_count, false);
+    print_phase("run_jit", run_jit, megabytes, token_count, statement_count, false);
+    std::printf("      \"bytecode_speedup\": %.2f, \"closure_speedup\": %.2f, \"jit_speedup\": %.2f, "
+                "\"closures_quickened\": %zu, \"closure_deoptimizations\": %zu, \"statements_fused\": %zu, "
+                "\"engines_match\": %s\n",
+                run.seconds / run_bytecode.seconds, run.seconds / run_closures.seconds, run.seconds / run_jit.seconds,
+                quickened, deoptimizations, fused, engines_match ? "true" : "false");
+    std::printf("    }%s\n", last ? "" : ",");
+    /* Quickening only ever happens on shared nodes, so this is the workload that proves it works */
+    return engines_match && (!HSharpBench::needs_deduplication(workload) || quickened > 0);
+}
+
+/* Counts what is allocated from it and catches memory handed back twice, or never handed
+ * out; it leaks what it was given back wrongly rather than pass it on */
+class CheckedResource : public std::pmr::memory_resource {
+private:
+    std::unordered_set<void*> live;
+    bool misused = false;
+
+    void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+        void* memory = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        live.insert(memory);
+        return memory;
+    }
+    void do_deallocate(void* memory, const std::size_t bytes, const std::size_t alignment) override {
+        if (live.erase(memory) == 0) {
+            misused = true;
+            return;
+        }
+        std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+    }
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    /* Everything was handed back, once */
+    [[nodiscard]] bool balanced() const { return !misused && live.empty(); }
+};
+
+/* Hand-written programs for what the generated workloads never do, each with the output
+ * every engine has to print. Strings are longer than the small-string buffer so that the
+ * tree walker allocates them from its resource. */
+struct EdgeCase {
+    const char* name;
+    const char* source;
+    const char* expected;
+};
+
+static constexpr EdgeCase edge_cases[] = {
+    /* The tree walker used to share a's string with d and free it twice */
+    {"var_copies_variable",
+     "var a = \"a string on the heap\";\nvar d = a;\nprint(d);\nprint(a);\n",
+     "a string on the heap\na string on the heap\n"},
+    {"self_assignment",
+     "var x = \"a string on the heap\";\nx = x;\nx = x;\nprint(x);\nvar n = 5;\nn = n;\nprint(n);\n",
+     "a string on the heap\n5\n"},
+    /* ... and to leak the value an assignment replaced */
+    {"assignment_replaces_value",
+     "var a = \"a string on the heap\";\nvar d = a;\na = \"another string on the heap\";\nprint(d);\nprint(a);\n",
+     "a string on the heap\nanother string on the heap\n"},
+    /* The one overflowing quotient, by a literal, by a variable, and deeper in an expression
+     * than the JIT keeps in registers */
+    {"int64_min_divided_by_minus_one",
+     "var a = 0 - 9223372036854775807 - 1;\nvar m = 0 - 1;\nprint(a / (0 - 1));\nprint(a / m);\nprint(7 / m);\n"
+     "print(1 + (1 + (1 + (1 + (1 + (1 + (1 + a / m)))))) - 7);\n",
+     "-9223372036854775808\n-9223372036854775808\n-7\n-9223372036854775808\n"},
+};
+
+/* Runs one program on every engine; false if any output differs from the expected one, the
+ * tree walker frees something twice, or a program nested deeper than the closure compiler
+ * recurses was not swept */
+static bool run_edge_case(const char* name, const std::string& source, const std::string& expected,
+                          const bool deep, const bool last) {
+    File source_file{std::string(source)};
+    HSharpParser::SymbolTable symbols;
+    HSharpParser::Tokenizer tokenizer(source_file, symbols);
+    HSharpParser::Parser parser(tokenizer);
+    const HSharpParser::NodeProgram program = parser.parse_program().value();
+    const HSharpVE::BytecodeProgram bytecode = HSharpVE::compile(program.view());
+    HSharpVE::ClosureProgram closures = HSharpVE::compile_closures(program.view());
+    const std::optional<HSharpVE::JitCode> jit = HSharpVE::JitCode::compile(bytecode, symbols.size());
+
+    std::string outputs[4];
+    CheckedResource checked;
+    {
+        HSharpVE::VirtualEnvironment ve(program.view(), symbols, false, &checked);
+        outputs[0] = capture_output([&] { ve.run(); });
+    }
+    HSharpVE::BytecodeVM vm(bytecode, symbols);
+    outputs[1] = capture_output([&] { vm.run(); });
+    HSharpVE::ClosureEngine closure_engine(closures, symbols);
+    outputs[2] = capture_output([&] { closure_engine.run(); });
+    HSharpVE::BytecodeVM jit_vm(bytecode, symbols);
+    outputs[3] = capture_output([&] { jit_vm.run(jit ? &*jit : nullptr); });
+
+    const bool match = checked.balanced() && (!deep || closures.swept > 0)
+        && std::all_of(std::begin(outputs), std::end(outputs),
+                       [&](const std::string& output) { return output == expected; });
+    std::printf("    {\"name\": \"%s\", \"closures_swept\": %zu, \"engines_match\": %s}%s\n", name, closures.swept,
+                match ? "true" : "false", last ? "" : ",");
+    return match;
+}
+
+/* A sum nested deeper than the closure compiler recurses on, so its eval_sweep fallback runs */
+static std::string deep_expression(const std::size_t depth) {
+    std::string source = "var a = 0 - 1;\nprint(a";
+    for (std::size_t i = 0; i < depth; i++)
+        source += " + 1";
+    source += ");\n";
+    return source;
+}
+
+static bool bench_edge_cases() {
+    constexpr std::size_t depth = 5000;
+    bool all_match = true;
+    std::printf("  \"edge_cases\": [\n");
+    for (const EdgeCase& edge_case : edge_cases)
+        all_match &= run_edge_case(edge_case.name, edge_case.source, edge_case.expected, false, false);
+    all_match &= run_edge_case("deeper_than_closure_recursion", deep_expression(depth),
+                               std::to_string(depth - 1) + "\n", true, true);
+    std::printf("  ],\n");
+    return all_match;
+}
+
+/* Many small statements, so an edit touches a tiny fraction of the program */
+static std::string generate_program(const std::size_t statements) {
+    std::string source;
+    for (std::size_t i = 0; i < statements; i++) {
+        source += "var v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+        source += "print(v" + std::to_string(i) + " + " + std::to_string(i) + ");\n";
+    }
+    return source;
+}
+
+/* Whether a and b hold the same statements with the same spans and expression nodes, operator
+ * offsets included; identifiers are compared by name and strings by value, so the two may
+ * come from different symbol tables and lay their string data out differently */
+static bool same_program(const HSharpParser::NodeProgram& a, const HSharpParser::SymbolTable& a_symbols,
+                         const HSharpParser::NodeProgram& b, const HSharpParser::SymbolTable& b_symbols) {
+    using HSharpParser::ExprKind;
+    using HSharpParser::StmtKind;
+    if (a.statements.size() != b.statements.size() || a.spans.size() != b.spans.size())
+        return false;
+    const HSharpParser::ProgramView a_view = a.view(), b_view = b.view();
+    for (std::size_t i = 0; i < a.statements.size(); i++) {
+        const HSharpParser::StmtNode& left = a.statements[i];
+        const HSharpParser::StmtNode& right = b.statements[i];
+        if (left.kind != right.kind || left.count != right.count
+            || a.spans[i].begin != b.spans[i].begin || a.spans[i].end != b.spans[i].end)
+            return false;
+        if ((left.kind == StmtKind::VAR || left.kind == StmtKind::ASSIGN)
+            && a_symbols.name(left.symbol) != b_symbols.name(right.symbol))
+            return false;
+        for (std::uint32_t j = 0; j < left.count; j++) {
+            const HSharpParser::ExprNode& x = a.expressions[left.first + j];
+            const HSharpParser::ExprNode& y = b.expressions[right.first + j];
+            if (x.kind != y.kind)
+                return false;
+            const bool same = x.kind == ExprKind::IDENT ? a_symbols.name(x.a) == b_symbols.name(y.a)
+                            : x.kind == ExprKind::STR_LIT ? a_view.string(x) == b_view.string(y)
+                                                          : x.a == y.a && x.b == y.b;
+            if (!same)
+                return false;
+        }
+    }
+    return true;
+}
+
+/* Times single-literal edits through IncrementalParser against a full reparse of the result,
+ * then checks that a syntax error leaves the program alone until the text parses again */
+static bool bench_incremental(const int iterations) {
+    File edited(generate_program(10000));
+    HSharpParser::SymbolTable symbols;
+    HSharpParser::IncrementalParser incremental(edited, symbols);
+    const std::string_view needle = "var v5000 = ";
+    double slowest = 0;
+    std::size_t reparsed = 0;
+    for (int i = 0; i < iterations * 20; i++) {
+        /* Rewrite the literal after needle, alternating its length */
+        const auto begin = static_cast<std::uint32_t>(edited.contents().find(needle) + needle.size());
+        const auto end = static_cast<std::uint32_t>(edited.contents().find(';', begin));
+        const HSharpParser::TextEdit edit{begin, end, std::to_string(i % 2 ? i : i * 1000)};
+        const auto start = std::chrono::steady_clock::now();
+        reparsed += incremental.apply(edit).value();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        slowest = std::max(slowest, elapsed.count());
+    }
+
+    HSharpParser::SymbolTable full_symbols;
+    HSharpParser::Tokenizer tokenizer(edited, full_symbols);
+    HSharpParser::Parser parser(tokenizer);
+    const auto start = std::chrono::steady_clock::now();
+    const HSharpParser::NodeProgram full = parser.parse_program().value();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const bool identical = same_program(incremental.program(), symbols, full, full_symbols);
+
+    /* Half a statement typed in front of another one, then deleted again */
+    const std::string typed = "var half = ";
+    const auto at = static_cast<std::uint32_t>(edited.contents().find(needle));
+    const std::size_t statement_count = incremental.program().statements.size();
+    bool recovers = !incremental.apply({at, at, typed}).has_value() && incremental.error().has_value()
+                    && incremental.program().statements.size() == statement_count;
+    recovers = recovers && incremental.apply({at, static_cast<std::uint32_t>(at + typed.size()), ""}).has_value()
+               && !incremental.error().has_value() && same_program(incremental.program(), symbols, full, full_symbols);
+
+    std::printf("  \"incremental\": {\"statements\": %zu, \"reparsed_per_edit\": %.2f, \"slowest_edit_us\": %.1f, "
+                "\"full_parse_us\": %.1f, \"matches_full_parse\": %s, \"survives_syntax_errors\": %s}\n",
+                full.spans.size(), static_cast<double>(reparsed) / (iterations * 20), slowest * 1e6, elapsed.count() * 1e6,
+                identical ? "true" : "false", recovers ? "true" : "false");
+    return identical && recovers;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t size_mb = 64;
+    std::size_t statements = 10000;
+    int iterations = 5;
+    bool use_arena = true;
+    bool deduplicate = false;
+    argparse::ArgumentParser argparser("hve_bench", VERSION);
+    argparser.add_argument("--size").help("lexer benchmark source size in MiB").default_value(std::size_t{64}).scan<'u', std::size_t>().store_into(size_mb);
+    argparser.add_argument("--statements").help("statements per generated workload").default_value(std::size_t{10000}).scan<'u', std::size_t>().store_into(statements);
+    argparser.add_argument("--no-arena").help("run the workloads on the global heap instead of an arena").default_value(false).implicit_value(true);
+    argparser.add_argument("--dedup").help("parse with statements whose whole expressions are identical sharing one copy").default_value(false).implicit_value(true);
+    argparser.add_argument("--iterations").help("timed runs per measurement").default_value(5).scan<'i', int>().store_into(iterations);
+    try {
+        argparser.parse_args(argc, argv);
+    } catch (std::exception& exception) {
+        std::cout << argparser;
+        exit(1);
+    }
+    /* The variables workload updates the first half of its statements' variables */
+    if (statements < 2) {
+        std::cerr << "--statements must be at least 2\n";
+        exit(1);
+    }
+    use_arena = argparser["--no-arena"] == false;
+    deduplicate = argparser["--dedup"] == true;
+
+    std::printf("{\n  \"version\": \"%s\",\n  \"kernels\": \"%.*s\",\n", VERSION,
+                static_cast<int>(HSharpParser::Scan::active_kernels().size()), HSharpParser::Scan::active_kernels().data());
+
+    std::printf("  \"workloads\": [\n");
+    bool engines_match = true;
+    for (std::size_t i = 0; i < HSharpBench::workloads.size(); i++)
+        engines_match &= bench_workload(HSharpBench::workloads[i], statements, iterations, use_arena, deduplicate,
+                                        i + 1 == HSharpBench::workloads.size());
+    std::printf("  ],\n");
+    const bool edge_cases_match = bench_edge_cases();
+
+    File source_file(HSharpBench::generate_lexer_input(size_mb * 1024 * 1024));
+    const double megabytes = static_cast<double>(source_file.size()) / 1e6;
+    std::printf("  \"tokenizer_kernels\": [\n");
+    bool first = true;
+    for (const char* kernels : {"scalar", "sse2", "avx2"}) {
+        if (!HSharpParser::Scan::select_kernels(kernels))
+            continue;
+        double best = 0;
+        std::size_t token_count = 0;
+        for (int i = 0; i < iterations; i++) {
+            HSharpParser::SymbolTable symbols;
+            HSharpParser::Tokenizer tokenizer(source_file, symbols);
+            const auto start = std::chrono::steady_clock::now();
+            const std::pmr::vector<Token> tokens = tokenizer.tokenize();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            token_count = tokens.size();
+            best = std::max(best, megabytes / elapsed.count());
+        }
+        std::printf("%s    {\"kernels\": \"%s\", \"bytes\": %llu, \"tokens\": %zu, \"mb_per_s\": %.2f}",
+                    first ? "" : ",\n", kernels, static_cast<unsigned long long>(source_file.size()), token_count, best);
+        first = false;
+    }
+    std::printf("\n  ],\n");
+
+    HSharpParser::Scan::select_kernels("avx2");
+    HSharpParser::SymbolTable reference_symbols;
+    HSharpParser::Tokenizer reference_tokenizer(source_file, reference_symbols);
+    const std::pmr::vector<Token> reference = reference_tokenizer.tokenize();
+    const std::size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool parallel_identical = true;
+    std::printf("  \"tokenizer_parallel\": [\n");
+    for (std::size_t threads = 1; threads <= hardware_threads; threads *= 2) {
+        HSharpParser::ThreadPool pool(threads);
+        double best = 0;
+        bool identical = true;
+        for (int i = 0; i < iterations; i++) {
+            HSharpParser::SymbolTable symbols;
+            HSharpParser::Tokenizer tokenizer(source_file, symbols);
+            const auto start = std::chrono::steady_clock::now();
+            const std::pmr::vector<Token> tokens = tokenizer.tokenize(pool);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            identical &= tokens.size() == reference.size() && std::equal(tokens.begin(), tokens.end(), reference.begin(),
+                [](const Token& a, const Token& b) {
+                    return a.ttype == b.ttype && a.offset == b.offset && a.length == b.length && a.symbol == b.symbol;
+                });
+            best = std::max(best, megabytes / elapsed.count());
+        }
+        std::printf("%s    {\"threads\": %zu, \"mb_per_s\": %.2f, \"matches_serial\": %s}", threads > 1 ? ",\n" : "",
+                    threads, best, identical ? "true" : "false");
+        parallel_identical &= identical;
+    }
+    std::printf("\n  ],\n");
+
+    const bool incremental_identical = bench_incremental(iterations);
+    std::printf("}\n");
+    return engines_match && edge_cases_match && parallel_identical && incremental_identical ? 0 : 1;
+}
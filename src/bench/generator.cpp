@@ -0,0 +1,127 @@
+#include <bench/generator.hpp>
+
+namespace {
+    /* Terms per generated expression in the EXPRESSIONS workload */
+    constexpr std::size_t expression_depth = 32;
+    constexpr std::size_t string_length = 256;
+
+    std::string variable(const std::size_t i) {
+        return "v" + std::to_string(i);
+    }
+
+    std::string generate_expressions(const std::size_t statements) {
+        std::string source = "var v0 = 1;\n";
+        for (std::size_t i = 1; i < statements; i++) {
+            /* Terms reference v0 only, so values stay small however many statements there are */
+            source += "var " + variable(i) + " = v0";
+            for (std::size_t term = 1; term < expression_depth; term++) {
+                const std::string literal = std::to_string(term * 31 % 97 + 1);
+                switch (term % 4) {
+                    case 0: source += " + " + literal; break;
+                    case 1: source += " * v0"; break;
+                    case 2: source += " - (" + literal + " + v0)"; break;
+                    default: source += " / " + literal;
+                }
+            }
+            source += ";\n";
+        }
+        return source;
+    }
+
+    std::string generate_variables(const std::size_t statements) {
+        std::string source;
+        const std::size_t declared = statements / 2;
+        for (std::size_t i = 0; i < declared; i++)
+            source += "var " + variable(i) + " = " + std::to_string(i) + ";\n";
+        for (std::size_t i = declared; i < statements; i++) {
+            const std::string name = variable((i * 7919) % declared);
+            source += name + " = " + name + " + 1;\n";
+        }
+        return source;
+    }
+
+    std::string generate_strings(const std::size_t statements) {
+        std::string source;
+        for (std::size_t i = 0; i < statements; i++) {
+            const std::string text(string_length, static_cast<char>('a' + i % 26));
+            source += i % 2 ? "print(\"" + text + "\");\n" : "var " + variable(i) + " = \"" + text + "\";\n";
+        }
+        return source;
+    }
+
+    std::string generate_comments(const std::size_t statements) {
+        std::string source;
+        for (std::size_t i = 0; i < statements; i++) {
+            source += "// line comment " + std::to_string(i) + " describing the next statement in some detail\n";
+            source += "/* block comment spanning\n   several lines; with \"quotes\" and // markers inside */\n";
+            source += "var " + variable(i) + " = " + std::to_string(i) + "; // trailing comment\n";
+        }
+        return source;
+    }
+
+    std::string generate_prints(const std::size_t statements) {
+        std::string source = "var v0 = 42;\n";
+        for (std::size_t i = 1; i < statements; i++) {
+            switch (i % 3) {
+                case 0: source += "print(v0);\n"; break;
+                case 1: source += "print(" + std::to_string(i) + " + v0);\n"; break;
+                default: source += "print(\"line " + std::to_string(i) + "\");\n";
+            }
+        }
+        return source;
+    }
+
+    /* Two expression statements over and over, which hash-consing turns into two runs of nodes
+     * for the closure engine to quicken; every so often a global only the first one reads
+     * turns into a string and back, which deoptimizes the first and leaves the second alone */
+    std::string generate_repeated(const std::size_t statements) {
+        const std::string repeated = "print(a * b + t - 2);\nprint(a - b * 5);\n";
+        std::string source = "var a = 3;\nvar b = 4;\nvar t = 1;\n";
+        for (std::size_t i = 3, round = 0; i < statements; i += 2, round++) {
+            source += repeated;
+            if (round % 25 == 2) {
+                source += "t = \"phase\";\nprint(t);\nt = 1;\n";
+                i += 3;
+            }
+        }
+        /* Ends quickened however few statements were asked for */
+        return source + repeated;
+    }
+}
+
+std::string_view HSharpBench::workload_name(const Workload workload) {
+    switch (workload) {
+        case Workload::EXPRESSIONS: return "expressions";
+        case Workload::VARIABLES: return "variables";
+        case Workload::STRINGS: return "strings";
+        case Workload::COMMENTS: return "comments";
+        case Workload::PRINTS: return "prints";
+        case Workload::REPEATED: return "repeated";
+    }
+    return "unknown";
+}
+
+std::string HSharpBench::generate(const Workload workload, const std::size_t statements) {
+    switch (workload) {
+        case Workload::EXPRESSIONS: return generate_expressions(statements);
+        case Workload::VARIABLES: return generate_variables(statements);
+        case Workload::STRINGS: return generate_strings(statements);
+        case Workload::COMMENTS: return generate_comments(statements);
+        case Workload::PRINTS: return generate_prints(statements);
+        case Workload::REPEATED: return generate_repeated(statements);
+    }
+    return {};
+}
+
+std::string HSharpBench::generate_lexer_input(const std::size_t target_size) {
+    std::string source;
+    source.reserve(target_size + 256);
+    for (std::size_t i = 0; source.size() < target_size; i++) {
+        source += "// generated statement " + std::to_string(i) + ", padding the line out like our generators do\n";
+        source += "var identifierNumber" + std::to_string(i) + " = " + std::to_string(i * 7919) + ";\n";
+        source += "/* block comment spanning\n   several lines of text that the lexer has to skip over */\n";
+        source += "print(\"" + std::string(96, 'x') + "\");\n";
+        source += "identifierNumber" + std::to_string(i) + " = identifierNumber" + std::to_string(i) + " + 1;\n";
+    }
+    return source;
+}
@@ -0,0 +1,332 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <version.hpp>
+#include <image/image.hpp>
+
+namespace {
+    constexpr char image_magic[8] = {'H', 'S', 'V', 'E', 'I', 'M', 'G', '\n'};
+    /* Bump whenever the layout below or of any record type changes, and whenever the parser
+     * changes what it encodes in them. 2: front-end flags, folded constants, shared
+     * expressions, IMPORT statements. */
+    constexpr std::uint32_t image_format = 2;
+    constexpr std::size_t section_alignment = 8;
+
+    struct Section {
+        std::uint64_t offset;
+        /* Element count for record arrays, byte count for blobs */
+        std::uint64_t size;
+    };
+
+    struct ImageHeader {
+        char magic[8];
+        std::uint32_t format;
+        std::uint32_t header_size;
+        char engine[16];
+        std::uint64_t source_hash;
+        std::uint64_t source_size;
+        /* Record sizes as built; a mismatch means a different ABI, not just a different version */
+        std::uint32_t stmt_size;
+        std::uint32_t expr_size;
+        std::uint32_t front_end_flags;
+        std::uint32_t reserved;
+        Section statements;
+        Section expressions;
+        Section string_data;
+        /* (offset, length) uint32 pairs into symbol_data, one per symbol id */
+        Section symbols;
+        Section symbol_data;
+        std::uint64_t file_size;
+        /* hash_source() of everything after the header; catches corruption the bounds checks cannot */
+        std::uint64_t payload_hash;
+    };
+
+    void engine_tag(char (&engine)[16]) {
+        std::memset(engine, 0, sizeof(engine));
+        std::strncpy(engine, VERSION, sizeof(engine) - 1);
+    }
+
+    std::uint64_t mix(const std::uint64_t a, const std::uint64_t b) {
+        const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+    }
+
+    std::uint64_t read_word(const char* bytes) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    /* Appends bytes at the next aligned offset and returns the section describing them */
+    Section append_section(std::string& out, const void* data, const std::size_t bytes, const std::uint64_t count) {
+        out.resize((out.size() + section_alignment - 1) / section_alignment * section_alignment);
+        const Section section{out.size(), count};
+        out.append(static_cast<const char*>(data), bytes);
+        return section;
+    }
+
+    /* True if count elements of element_size at section.offset lie inside a file of file_size */
+    bool section_fits(const Section& section, const std::size_t element_size, const std::uint64_t file_size,
+                      const std::size_t alignment) {
+        return section.offset % alignment == 0 && section.offset <= file_size &&
+               section.size <= (file_size - section.offset) / element_size;
+    }
+
+    /* Checks what the VE relies on without checking: statement ranges inside the node array,
+     * well-formed postorder (every operator has two operands, one value left), symbol ids in
+     * range and string slices inside the string data. Programs with imports are never cached,
+     * so an IMPORT statement is as invalid as an unknown kind. */
+    bool program_is_valid(const HSharpParser::ProgramView& program, const std::uint32_t symbol_count) {
+        using HSharpParser::ExprKind;
+        using HSharpParser::StmtKind;
+        for (const HSharpParser::StmtNode& stmt : program.statements) {
+            if (stmt.kind >= StmtKind::IMPORT || stmt.count == 0 || stmt.first > program.expressions.size() ||
+                stmt.count > program.expressions.size() - stmt.first)
+                return false;
+            if ((stmt.kind == StmtKind::VAR || stmt.kind == StmtKind::ASSIGN) && stmt.symbol >= symbol_count)
+                return false;
+            std::size_t depth = 0;
+            for (const HSharpParser::ExprNode& node : program.expressions.subspan(stmt.first, stmt.count)) {
+                switch (node.kind) {
+                    case ExprKind::INT_LIT:
+                        depth++;
+                        break;
+                    case ExprKind::IDENT:
+                        if (node.a >= symbol_count)
+                            return false;
+                        depth++;
+                        break;
+                    case ExprKind::STR_LIT:
+                        if (node.a > program.string_data.size() || node.b > program.string_data.size() - node.a)
+                            return false;
+                        depth++;
+                        break;
+                    case ExprKind::ADD:
+                    case ExprKind::SUB:
+                    case ExprKind::MUL:
+                    case ExprKind::DIV:
+                        if (depth < 2)
+                            return false;
+                        depth--;
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            if (depth != 1)
+                return false;
+        }
+        return true;
+    }
+}
+
+std::uint64_t HSharpParser::hash_source(const std::string_view source) {
+    /* Multiply-fold over 16-byte blocks; runs at memory speed, which matters because every
+     * cached run pays for it */
+    constexpr std::uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull, k2 = 0x8ebc6af09c88c6e3ull;
+    std::uint64_t state = k0 ^ source.size();
+    std::size_t i = 0;
+    for (; i + 16 <= source.size(); i += 16)
+        state = mix(read_word(source.data() + i) ^ k1 ^ state, read_word(source.data() + i + 8) ^ k2);
+    char tail[16] = {};
+    std::memcpy(tail, source.data() + i, source.size() - i);
+    state = mix(read_word(tail) ^ k1 ^ state, read_word(tail + 8) ^ k2);
+    return mix(state ^ k0, source.size() ^ k1);
+}
+
+HSharpParser::ProgramImage::ProgramImage(ProgramImage&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)),
+      mapping_size(std::exchange(other.mapping_size, 0)),
+      program(std::exchange(other.program, {})),
+      symbol_records(std::exchange(other.symbol_records, nullptr)),
+      symbol_count(std::exchange(other.symbol_count, 0)),
+      symbol_data(std::exchange(other.symbol_data, {})) {}
+
+HSharpParser::ProgramImage& HSharpParser::ProgramImage::operator=(ProgramImage&& other) noexcept {
+    if (this != &other) {
+        if (mapping)
+            munmap(mapping, mapping_size);
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+        program = std::exchange(other.program, {});
+        symbol_records = std::exchange(other.symbol_records, nullptr);
+        symbol_count = std::exchange(other.symbol_count, 0);
+        symbol_data = std::exchange(other.symbol_data, {});
+    }
+    return *this;
+}
+
+HSharpParser::ProgramImage::~ProgramImage() {
+    if (mapping)
+        munmap(mapping, mapping_size);
+}
+
+std::optional<HSharpParser::ProgramImage> HSharpParser::ProgramImage::load(const std::string& path,
+                                                                           const std::uint64_t source_hash,
+                                                                           const std::uint64_t source_size,
+                                                                           const std::uint32_t front_end_flags) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || static_cast<std::uint64_t>(info.st_size) < sizeof(ImageHeader)) {
+        close(fd);
+        return {};
+    }
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return {};
+
+    ProgramImage image;
+    image.mapping = mapped;
+    image.mapping_size = size;
+    const char* const base = static_cast<const char*>(mapped);
+    ImageHeader header{};
+    std::memcpy(&header, base, sizeof(header));
+    char engine[16];
+    engine_tag(engine);
+    if (std::memcmp(header.magic, image_magic, sizeof(image_magic)) != 0 || header.format != image_format ||
+        header.header_size != sizeof(ImageHeader) || std::memcmp(header.engine, engine, sizeof(engine)) != 0 ||
+        header.source_hash != source_hash || header.source_size != source_size ||
+        header.front_end_flags != front_end_flags || header.stmt_size != sizeof(StmtNode) || header.expr_size != sizeof(ExprNode) || header.file_size != size ||
+        header.payload_hash != hash_source({base + sizeof(ImageHeader), size - sizeof(ImageHeader)}))
+        return {};
+    if (!section_fits(header.statements, sizeof(StmtNode), size, section_alignment) ||
+        !section_fits(header.expressions, sizeof(ExprNode), size, section_alignment) ||
+        !section_fits(header.string_data, 1, size, 1) ||
+        !section_fits(header.symbols, 2 * sizeof(std::uint32_t), size, section_alignment) ||
+        !section_fits(header.symbol_data, 1, size, 1) ||
+        header.symbols.size > UINT32_MAX || header.string_data.size > UINT32_MAX)
+        return {};
+
+    image.program = {
+        .statements = {reinterpret_cast<const StmtNode*>(base + header.statements.offset), header.statements.size},
+        .expressions = {reinterpret_cast<const ExprNode*>(base + header.expressions.offset), header.expressions.size},
+        .string_data = {base + header.string_data.offset, header.string_data.size}
+    };
+    image.symbol_records = reinterpret_cast<const std::uint32_t*>(base + header.symbols.offset);
+    image.symbol_count = static_cast<std::uint32_t>(header.symbols.size);
+    image.symbol_data = {base + header.symbol_data.offset, header.symbol_data.size};
+    for (std::uint32_t id = 0; id < image.symbol_count; id++) {
+        const std::uint32_t offset = image.symbol_records[2 * id], length = image.symbol_records[2 * id + 1];
+        if (offset > image.symbol_data.size() || length > image.symbol_data.size() - offset)
+            return {};
+    }
+    if (!program_is_valid(image.program, image.symbol_count))
+        return {};
+    return image;
+}
+
+bool HSharpParser::ProgramImage::write(const std::string& path, const NodeProgram& program, const SymbolTable& symbols,
+                                       const std::uint64_t source_hash, const std::uint64_t source_size,
+                                       const std::uint32_t front_end_flags) {
+    std::string symbol_data;
+    std::vector<std::uint32_t> symbol_records;
+    symbol_records.reserve(symbols.size() * 2);
+    for (std::uint32_t id = 0; id < symbols.size(); id++) {
+        symbol_records.push_back(static_cast<std::uint32_t>(symbol_data.size()));
+        symbol_records.push_back(static_cast<std::uint32_t>(symbols.name(id).size()));
+        symbol_data.append(symbols.name(id));
+    }
+
+    ImageHeader header{};
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.format = image_format;
+    header.header_size = sizeof(ImageHeader);
+    engine_tag(header.engine);
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.stmt_size = sizeof(StmtNode);
+    header.expr_size = sizeof(ExprNode);
+    header.front_end_flags = front_end_flags;
+
+    std::string out(sizeof(ImageHeader), '\0');
+    header.statements = append_section(out, program.statements.data(), program.statements.size() * sizeof(StmtNode),
+                                       program.statements.size());
+    header.expressions = append_section(out, program.expressions.data(), program.expressions.size() * sizeof(ExprNode),
+                                        program.expressions.size());
+    header.symbols = append_section(out, symbol_records.data(), symbol_records.size() * sizeof(std::uint32_t),
+                                    symbols.size());
+    header.string_data = append_section(out, program.string_data.data(), program.string_data.size(),
+                                        program.string_data.size());
+    header.symbol_data = append_section(out, symbol_data.data(), symbol_data.size(), symbol_data.size());
+    header.file_size = out.size();
+    header.payload_hash = hash_source(std::string_view(out).substr(sizeof(ImageHeader)));
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    /* Readers only ever see a complete image: write aside, then rename over */
+    const std::string temporary = path + ".tmp." + std::to_string(getpid());
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    const bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    if (std::fclose(file) != 0 || !written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void HSharpParser::ProgramImage::restore_symbols(SymbolTable& symbols) const {
+    for (std::uint32_t id = 0; id < symbol_count; id++)
+        symbols.intern(symbol_data.substr(symbol_records[2 * id], symbol_records[2 * id + 1]));
+}
+
+std::optional<HSharpParser::ImageCache> HSharpParser::ImageCache::open() {
+    std::string directory;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        directory = xdg;
+    else if (const char* home = std::getenv("HOME"); home && *home)
+        directory = std::string(home) + "/.cache";
+    else
+        return {};
+    directory += "/hsharpve";
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+        return {};
+    return ImageCache(std::move(directory));
+}
+
+std::string HSharpParser::ImageCache::path_for(const std::uint64_t source_hash, const std::uint64_t source_size,
+                                               const std::uint32_t front_end_flags) const {
+    char name[80];
+    std::snprintf(name, sizeof(name), "/%016" PRIx64 "-%" PRIx64 "-%" PRIx32 "-%s.hvi", source_hash, source_size,
+                  front_end_flags, VERSION);
+    return directory + name;
+}
+
+HSharpParser::CacheStats HSharpParser::ImageCache::record(const CacheStats& run) const {
+    const std::string path = directory + "/stats";
+    CacheStats totals;
+    if (FILE* file = std::fopen(path.c_str(), "r")) {
+        if (std::fscanf(file, "hits %" SCNu64 " misses %" SCNu64 " write_failures %" SCNu64, &totals.hits,
+                        &totals.misses, &totals.write_failures) != 3)
+            totals = {};
+        std::fclose(file);
+    }
+    totals.hits += run.hits;
+    totals.misses += run.misses;
+    totals.write_failures += run.write_failures;
+
+    /* Same as images: write aside, then rename over. Concurrent runs may lose an update. */
+    const std::string temporary = path + ".tmp." + std::to_string(getpid());
+    FILE* file = std::fopen(temporary.c_str(), "w");
+    if (!file)
+        return totals;
+    const bool written = std::fprintf(file, "hits %" PRIu64 "\nmisses %" PRIu64 "\nwrite_failures %" PRIu64 "\n",
+                                      totals.hits, totals.misses, totals.write_failures) > 0;
+    if (std::fclose(file) != 0 || !written || std::rename(temporary.c_str(), path.c_str()) != 0)
+        std::remove(temporary.c_str());
+    return totals;
+}
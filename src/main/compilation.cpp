@@ -0,0 +1,71 @@
+#include <iostream>
+#include <utility>
+
+#include <main/compilation.hpp>
+#include <parser/modules.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+HSharpParser::Compilation::Compilation(File source)
+    : source(std::move(source)),
+      arena(std::make_unique<ArenaAllocator>(1024 * 1024)),
+      token_arena(std::make_unique<ArenaAllocator>(1024 * 1024)) {}
+
+std::optional<HSharpParser::Compilation> HSharpParser::Compilation::open(const std::string& path) {
+    std::optional<File> opened = File::open(path);
+    if (!opened.has_value())
+        return {};
+    return Compilation(std::move(opened.value()));
+}
+
+void HSharpParser::Compilation::tokenize(ThreadPool* pool) {
+    Tokenizer tokenizer(source.value(), symbols);
+    try {
+        tokens = pool ? tokenizer.tokenize(*pool, token_arena.get()) : tokenizer.tokenize(token_arena.get());
+    } catch (const SyntaxError& error) {
+        exit_on(error);
+    }
+}
+
+void HSharpParser::Compilation::parse(const bool deduplicate) {
+    Tokenizer tokenizer(source.value(), symbols);
+    /* Reads the tokens in place: the parser only ever holds a span of them */
+    Parser parser = tokens ? Parser(tokenizer, tokens.value()) : Parser(tokenizer);
+    try {
+        program = parser.parse_program(arena.get(), deduplicate);
+    } catch (const SyntaxError& error) {
+        exit_on(error);
+    }
+    if (!program.has_value()) {
+        std::cerr << "Parsing failed!\n";
+        exit(1);
+    }
+    folded = parser.folded_constants();
+    shared = parser.shared_expressions();
+}
+
+bool HSharpParser::Compilation::has_imports() const {
+    return program.has_value() && ModuleLoader::has_imports(program.value());
+}
+
+bool HSharpParser::Compilation::link(ThreadPool& pool) {
+    ModuleLoader loader(pool);
+    std::optional<NodeProgram> linked = loader.load(source.value(), program.value(), symbols, arena.get());
+    if (!linked.has_value())
+        return false;
+    /* Move-constructed, so the arrays are adopted rather than copied */
+    program.reset();
+    program.emplace(std::move(linked.value()));
+    modules = loader.module_count();
+    return true;
+}
+
+void HSharpParser::Compilation::adopt(ProgramImage cached) {
+    cached.restore_symbols(symbols);
+    image.emplace(std::move(cached));
+}
+
+void HSharpParser::Compilation::release_front_end() {
+    tokens.reset();
+    token_arena.reset();
+    source.reset();
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <main/file.hpp>
+#include <parser/scan.hpp>
+
+namespace {
+    constexpr std::size_t read_chunk_size = 1 << 16;
+    /* Tokens address the source with 32-bit offsets */
+    constexpr std::uint64_t max_source_size = std::numeric_limits<std::uint32_t>::max();
+
+    bool read_all(const int fd, std::string& out) {
+        std::size_t used = 0;
+        while (true) {
+            if (out.size() - used < read_chunk_size)
+                out.resize(std::max(out.size() * 2, used + read_chunk_size));
+            const ssize_t got = ::read(fd, out.data() + used, out.size() - used);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                return false;
+            if (got == 0)
+                break;
+            used += static_cast<std::size_t>(got);
+        }
+        out.resize(used);
+        return true;
+    }
+}
+
+File::File(std::string contents) : buffer(std::move(contents)), data(buffer) {}
+
+File::File(File&& other) noexcept
+    : path(std::move(other.path)),
+      buffer(std::move(other.buffer)),
+      mapping(std::exchange(other.mapping, nullptr)),
+      mapping_size(std::exchange(other.mapping_size, 0)),
+      line_starts(std::move(other.line_starts)) {
+    /* A moved short string changes address, so the view is rebuilt rather than copied */
+    data = mapping ? std::string_view(static_cast<const char*>(mapping), mapping_size) : std::string_view(buffer);
+    other.data = {};
+}
+
+File& File::operator=(File&& other) noexcept {
+    if (this != &other) {
+        release();
+        path = std::move(other.path);
+        buffer = std::move(other.buffer);
+        line_starts = std::move(other.line_starts);
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+        data = mapping ? std::string_view(static_cast<const char*>(mapping), mapping_size) : std::string_view(buffer);
+        other.data = {};
+    }
+    return *this;
+}
+
+File::~File() {
+    release();
+}
+
+void File::release() {
+    if (mapping)
+        munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    data = {};
+}
+
+std::optional<File> File::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Cannot open file " << path << ": " << std::strerror(errno) << std::endl;
+        return {};
+    }
+
+    File file;
+    file.path = path;
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        if (static_cast<std::uint64_t>(info.st_size) > max_source_size) {
+            std::cerr << "File " << path << " is too large: sources are limited to 4 GiB" << std::endl;
+            close(fd);
+            return {};
+        }
+        const auto size = static_cast<std::size_t>(info.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            /* Lexing is one forward pass: read ahead aggressively and drop pages behind us */
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            madvise(mapped, size, MADV_WILLNEED);
+            file.mapping = mapped;
+            file.mapping_size = size;
+            file.data = {static_cast<const char*>(mapped), size};
+            close(fd);
+            return file;
+        }
+    }
+
+    /* Pipes, character devices, procfs and mmap failures */
+    if (!read_all(fd, file.buffer)) {
+        std::cerr << "File read failure: " << path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return {};
+    }
+    close(fd);
+    if (file.buffer.size() > max_source_size) {
+        std::cerr << "File " << path << " is too large: sources are limited to 4 GiB" << std::endl;
+        return {};
+    }
+    file.data = file.buffer;
+    return file;
+}
+
+bool File::edit(const std::uint32_t begin, const std::uint32_t end, const std::string_view replacement) {
+    if (begin > end || end > data.size() || data.size() - (end - begin) + replacement.size() > max_source_size)
+        return false;
+    if (mapping) {
+        /* The first edit takes a private copy; the mapping is read-only */
+        buffer.assign(data);
+        release();
+    }
+    buffer.replace(begin, end - begin, replacement);
+    data = buffer;
+    line_starts.clear();
+    return true;
+}
+
+void File::build_line_index() const {
+    const char* const begin = data.data();
+    const char* const end = begin + data.size();
+    line_starts.reserve(HSharpParser::Scan::count_byte(begin, end, '\n') + 1);
+    line_starts.push_back(0);
+    for (const char* newline = HSharpParser::Scan::find_byte(begin, end, '\n'); newline != end;
+         newline = HSharpParser::Scan::find_byte(newline + 1, end, '\n'))
+        line_starts.push_back(static_cast<std::uint32_t>(newline - begin + 1));
+}
+
+SourceLocation File::location(const std::uint32_t offset) const {
+    if (line_starts.empty())
+        build_line_index();
+    const auto line = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+    return {
+        .line = static_cast<std::uint32_t>(line - line_starts.begin()),
+        .column = offset - *(line - 1) + 1
+    };
+}
+
+std::string File::describe(const std::uint32_t offset) const {
+    const SourceLocation where = location(offset);
+    return path + ':' + std::to_string(where.line) + ':' + std::to_string(where.column);
+}
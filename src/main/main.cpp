@@ -1,25 +1,35 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <fstream>
-#include <vector>
-#include <filesystem>
+#include <memory_resource>
+#include <thread>
 
 #include <version.hpp>
-#include <parser/parser.hpp>
-#include <main/file.hpp>
+#include <main/compilation.hpp>
+#include <image/image.hpp>
+#include <thread_pool/thread_pool.hpp>
+#include <ve/bytecode.hpp>
+#include <ve/closure.hpp>
+#include <ve/jit.hpp>
+#include <ve/shapes.hpp>
 #include <ve/ve.hpp>
 #include <argparse/argparse.hpp>
 
-using HSharpParser::Token;
-using HSharpParser::NodeExit;
-
 void DisplayHelp(const char*);
 
 int main(int argc, char *argv[]) {
     std::string filename;
+    /* hardware_concurrency() may return 0 when it cannot tell */
+    std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
     argparse::ArgumentParser argparser(argv[0], VERSION, argparse::default_arguments::help);
     argparser.add_argument("file").help("File to execute").metavar("PROGRAM").store_into(filename).required();
     argparser.add_argument("--version").help("display HSharpVE version").default_value(false).implicit_value(true);
-    argparser.add_argument("-v, --verbose").help("enable high verbosity level").default_value(false);
+    argparser.add_argument("-v", "--verbose").help("enable high verbosity level").default_value(false).implicit_value(true);
+    argparser.add_argument("-j", "--jobs").help("lex large sources and parse imported modules on this many threads (default: one per hardware thread)").default_value(jobs).scan<'u', std::size_t>().store_into(jobs);
+    argparser.add_argument("--dedup").help("let statements whose whole expressions are identical share one copy; subexpressions are not shared").default_value(false).implicit_value(true);
+    argparser.add_argument("--engine").help("execute by walking the AST (tree), as register bytecode (bytecode), as compiled closures (closure) or as x86-64 machine code (jit)").default_value(std::string("tree")).choices("tree", "bytecode", "closure", "jit");
+    argparser.add_argument("--profile").help("report the most frequent node-shape n-grams before running").default_value(false).implicit_value(true);
+    argparser.add_argument("--no-cache").help("neither use nor write cached program images").default_value(false).implicit_value(true);
     try {
         argparser.parse_args(argc, argv);
     } catch (std::exception& exception) {
@@ -35,35 +45,123 @@ int main(int argc, char *argv[]) {
         exit(0);
     }
 
-    std::ifstream input(filename, std::ios::binary | std::ios::ate);
-    if (!input.is_open()) {
-        std::cerr << "Cannot open file! Exiting now..." << std::endl;
+    std::optional<HSharpParser::Compilation> opened = HSharpParser::Compilation::open(filename);
+    if (!opened.has_value())
         exit(1);
-    }
-    File source_file;
+    HSharpParser::Compilation compilation = std::move(opened.value());
+    const File& source_file = compilation.source_file();
 
-    source_file.size = std::filesystem::file_size(argv[1]);
-    source_file.contents = std::string(source_file.size, '\0');
-    input.seekg(0);
-    if (!input.read(&source_file.contents.value()[0], source_file.size)) {
-        std::cerr << "File read failure!" << std::endl;
-        exit(1);
+    const bool verbose = argparser["--verbose"] == true;
+    const auto started = std::chrono::steady_clock::now();
+    const auto elapsed_ms = [&started] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    };
+
+    /* A cached image of the same source skips the front end entirely: the VE runs straight
+     * off the mapping */
+    std::optional<HSharpParser::ImageCache> cache;
+    HSharpParser::CacheStats lookups;
+    std::uint64_t source_hash = 0;
+    const std::uint32_t front_end_flags = argparser["--dedup"] == true ? HSharpParser::FRONT_END_DEDUPLICATE : 0;
+    std::string image_path;
+    if (argparser["--no-cache"] == false && (cache = HSharpParser::ImageCache::open())) {
+        source_hash = HSharpParser::hash_source(source_file.contents());
+        image_path = cache->path_for(source_hash, source_file.size(), front_end_flags);
     }
+    std::optional<HSharpParser::ProgramImage> image;
+    if (!image_path.empty())
+        image = HSharpParser::ProgramImage::load(image_path, source_hash, source_file.size(), front_end_flags);
 
-    HSharpParser::Tokenizer tokenizer(source_file);
-    std::vector<Token> tokens = tokenizer.tokenize();
+    if (image) {
+        compilation.adopt(std::move(image.value()));
+        lookups.hits++;
+        if (verbose)
+            std::cerr << "[VE] image cache hit: running the cached image " << image_path << " instead of parsing ("
+                      << elapsed_ms() << " ms)\n";
+    } else {
+        if (cache)
+            lookups.misses++;
+        if (jobs > 1) {
+            HSharpParser::ThreadPool pool(jobs);
+            compilation.tokenize(&pool);
+        }
+        compilation.parse(argparser["--dedup"] == true);
+        if (verbose) {
+            std::cerr << "[VE] constant folding: " << compilation.folded_constants() << " operators folded\n";
+            if (argparser["--dedup"] == true)
+                std::cerr << "[VE] deduplication: " << compilation.shared_expressions() << " statements share nodes, "
+                          << compilation.ast().expressions.size() << " nodes, "
+                          << compilation.ast().string_data.size() << " string bytes\n";
+        }
+        if (compilation.has_imports()) {
+            /* Imported modules can change while the root does not, so linked programs are never cached */
+            image_path.clear();
+            HSharpParser::ThreadPool pool(jobs);
+            if (!compilation.link(pool))
+                exit(1);
+            if (verbose)
+                std::cerr << "[VE] modules: " << compilation.module_count() << " loaded and linked on " << pool.size()
+                          << " threads (" << elapsed_ms() << " ms)\n";
+        }
+        if (!image_path.empty()) {
+            const double parsed_ms = elapsed_ms();
+            const bool written = HSharpParser::ProgramImage::write(image_path, compilation.ast(),
+                                                                   compilation.symbol_table(), source_hash,
+                                                                   source_file.size(), front_end_flags);
+            lookups.write_failures += !written;
+            if (verbose)
+                std::cerr << "[VE] image cache miss: parsed in " << parsed_ms << " ms, "
+                          << (written ? "wrote " : "could not write ") << image_path << '\n';
+        }
+    }
+    if (cache) {
+        const HSharpParser::CacheStats totals = cache->record(lookups);
+        if (verbose)
+            std::cerr << "[VE] image cache totals: " << totals.hits << " hits, " << totals.misses << " misses, "
+                      << totals.write_failures << " write failures (" << cache->path() << "/stats)\n";
+    } else if (verbose) {
+        std::cerr << "[VE] image cache disabled\n";
+    }
+    compilation.release_front_end();
 
-    HSharpParser::Parser parser(tokens);
-    std::optional<HSharpParser::NodeProgram> root = parser.parse_program();
-    if (!root.has_value()) {
-        std::cerr << "Parsing failed!\n";
-        exit(1);
+    if (argparser["--profile"] == true) {
+        HSharpVE::ShapeProfile profile;
+        profile.add(compilation.view());
+        profile.report(stderr, 10);
     }
 
-    HSharpVE::VirtualEnvironment ve(root.value(), argparser["-v, --verbose"] == true);
-    ve.run();
+    std::pmr::unsynchronized_pool_resource runtime_memory(compilation.memory());
+    const std::string engine = argparser.get<std::string>("--engine");
+    if (engine == "bytecode" || engine == "jit") {
+        const HSharpVE::BytecodeProgram bytecode = HSharpVE::compile(compilation.view(), compilation.memory());
+        if (verbose)
+            std::cerr << "[VE] bytecode: " << bytecode.code.size() << " instructions, " << bytecode.constants.size()
+                      << " constants, " << bytecode.register_count << " registers, " << bytecode.fused
+                      << " statements fused\n";
+        std::optional<HSharpVE::JitCode> jit;
+        if (engine == "jit") {
+            jit = HSharpVE::JitCode::compile(bytecode, compilation.symbol_table().size());
+            if (verbose && jit)
+                std::cerr << "[VE] jit: " << jit->size() << " bytes of machine code for " << jit->compiled_instructions()
+                          << " of " << bytecode.code.size() << " instructions\n";
+            else if (verbose)
+                std::cerr << "[VE] jit unavailable, interpreting the bytecode\n";
+        }
+        HSharpVE::BytecodeVM vm(bytecode, compilation.symbol_table(), &runtime_memory);
+        vm.run(jit ? &*jit : nullptr);
+    } else if (engine == "closure") {
+        HSharpVE::ClosureProgram closures = HSharpVE::compile_closures(compilation.view(), compilation.memory());
+        if (verbose)
+            std::cerr << "[VE] closures: " << closures.expressions.size() << " expression nodes, "
+                      << closures.statements.size() << " statements, " << closures.swept << " swept, " << closures.fused
+                      << " fused\n";
+        HSharpVE::ClosureEngine closure_engine(closures, compilation.symbol_table(), &runtime_memory);
+        closure_engine.run();
+    } else {
+        HSharpVE::VirtualEnvironment ve(compilation.view(), compilation.symbol_table(), verbose, &runtime_memory);
+        ve.run();
+    }
     // Exit point
-    input.close();
 }
 
 void DisplayHelp(const char* program_name) {
@@ -72,4 +170,10 @@ void DisplayHelp(const char* program_name) {
     std::puts("  --version       Display info about version");
     std::puts("  -h, --help      Display this menu");
     std::puts("  -v, --verbose   Set high verbosity level - get more info");
+    std::puts("  -j, --jobs N    Lex large sources and parse imported modules on N threads (default: one per hardware thread)");
+    std::puts("  --dedup         Share one copy of identical whole statement expressions");
+    std::puts("  --engine E      Execute with the tree walker (tree, default), the bytecode VM (bytecode),");
+    std::puts("                  compiled closures (closure) or the x86-64 JIT (jit)");
+    std::puts("  --profile       Report the most frequent node-shape n-grams before running");
+    std::puts("  --no-cache      Do not use or write cached program images");
 }
\ No newline at end of file
@@ -1,41 +1,66 @@
+#include <cassert>
+#include <iostream>
 #include <optional>
 
 #include <parser/parser.hpp>
 
-[[nodiscard]] std::optional<char> HSharpParser::Tokenizer::peek(const int offset) const {
-    if (index + offset >= file.contents.value().size())
-        return {};
-    else
-        return file.contents.value().at(index + offset);
-}
-
-char HSharpParser::Tokenizer::consume() {
-    return file.contents.value().at(index++);
-}
-
-[[nodiscard]] std::optional<HSharpParser::Token> HSharpParser::Parser::peek(const int offset) const {
-    if (index + offset >= tokens.size())
-        return {};
-    else
-        return tokens.at(index + offset);
+const HSharpParser::Token* HSharpParser::Parser::peek(const int offset) {
+    assert(offset >= 0 && static_cast<std::size_t>(offset) < lookahead);
+    if (pre_lexed.has_value()) {
+        if (index + offset >= pre_lexed->size())
+            return nullptr;
+        return &(*pre_lexed)[index + offset];
+    }
+    while (ring_count <= static_cast<std::size_t>(offset)) {
+        if (!stream.next(ring[(ring_head + ring_count) & (lookahead - 1)]))
+            return nullptr;
+        ring_count++;
+    }
+    return &ring[(ring_head + offset) & (lookahead - 1)];
 }
 
 HSharpParser::Token HSharpParser::Parser::consume() {
-    return tokens.at(index++);
+    Token token;
+    if (pre_lexed.has_value()) {
+        assert(index < pre_lexed->size());
+        token = (*pre_lexed)[index++];
+    } else {
+        [[maybe_unused]] const Token* available = peek();
+        assert(available);
+        token = ring[ring_head];
+        ring_head = (ring_head + 1) & (lookahead - 1);
+        ring_count--;
+    }
+    /* String literal tokens stop before the closing quote */
+    consumed_end = token.offset + token.length + (token.ttype == TokenType::TOK_STR_LIT);
+    return token;
 }
 
 HSharpParser::Token HSharpParser::Parser::try_consume(TokenType type, const char* err_msg) {
-    if (peek().has_value() && peek().value().ttype == type)
+    if (next_is(type))
         return consume();
     else {
-        std::cerr << err_msg << std::endl;
-        exit(1);
+        fail(err_msg);
     }
 }
 
 std::optional<HSharpParser::Token> HSharpParser::Parser::try_consume(TokenType type) {
-    if (peek().has_value() && peek().value().ttype == type)
+    if (next_is(type))
         return consume();
     else
         return {};
 }
+
+void HSharpParser::Parser::fail(const char* message) {
+    const Token* token = peek();
+    fail(message, token ? token->offset : static_cast<std::uint32_t>(stream.source_file().size()));
+}
+
+void HSharpParser::Parser::fail(const char* message, const std::uint32_t offset) {
+    throw SyntaxError(stream.source_file().describe(offset) + ": " + message);
+}
+
+void HSharpParser::exit_on(const SyntaxError& error) {
+    std::cerr << error.what() << std::endl;
+    exit(1);
+}
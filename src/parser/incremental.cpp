@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <span>
+
+#include <parser/incremental.hpp>
+
+HSharpParser::IncrementalParser::IncrementalParser(File& file, SymbolTable& symbols) : file(file), symbols(symbols) {
+    reparse();
+}
+
+bool HSharpParser::IncrementalParser::reparse() {
+    Tokenizer tokenizer(file, symbols);
+    Parser parser(tokenizer);
+    try {
+        parsed = parser.parse_program().value();
+    } catch (const SyntaxError& error) {
+        failure = error;
+        return false;
+    }
+    failure.reset();
+    garbage = 0;
+    return true;
+}
+
+std::optional<std::size_t> HSharpParser::IncrementalParser::apply(const TextEdit& edit) {
+    if (!file.edit(edit.begin, edit.end, edit.replacement))
+        return {};
+    if (failure) {
+        if (!reparse())
+            return {};
+        return parsed.statements.size();
+    }
+    const std::int64_t delta = static_cast<std::int64_t>(edit.replacement.size()) - (edit.end - edit.begin);
+
+    auto& statements = parsed.statements;
+    auto& spans = parsed.spans;
+    /* First statement whose text the edit can reach; an edit right after a ';' cannot change it */
+    const std::size_t first = std::partition_point(spans.begin(), spans.end(),
+        [&](const StatementSpan& span) { return span.end <= edit.begin; }) - spans.begin();
+
+    Tokenizer tokenizer(file, symbols);
+    tokenizer.seek(first > 0 ? spans[first - 1].end : 0);
+    Parser parser(tokenizer);
+
+    /* New nodes and string data go after all existing ones; the replaced ones become garbage */
+    std::vector<StmtNode> fresh;
+    std::vector<StatementSpan> fresh_spans;
+    /* One past the last old statement replaced; statements.size() means parse to the end */
+    std::size_t resync = statements.size();
+    std::size_t old = first;
+    StatementSpan span{};
+    const std::size_t nodes = parsed.expressions.size();
+    try {
+        while (auto stmt = parser.next_statement(parsed, span)) {
+            fresh.push_back(stmt.value());
+            fresh_spans.push_back(span);
+            /* Old statements ending after the edit still end at the same text once shifted; the
+             * lexer and parser carry no state across a ';', so matching one ends the work */
+            while (old < statements.size() && spans[old].end + delta < span.end)
+                old++;
+            if (old < statements.size() && spans[old].end > edit.end && spans[old].end + delta == span.end) {
+                resync = old + 1;
+                break;
+            }
+        }
+    } catch (const SyntaxError& error) {
+        /* Nothing has been replaced yet; the nodes parsed before the error are just garbage */
+        garbage += parsed.expressions.size() - nodes;
+        failure = error;
+        return {};
+    }
+
+    /* Operator nodes keep their token's offset, for diagnostics; it moves with the text */
+    for (std::size_t i = resync; i < spans.size(); i++) {
+        spans[i].begin = static_cast<std::uint32_t>(spans[i].begin + delta);
+        spans[i].end = static_cast<std::uint32_t>(spans[i].end + delta);
+        for (ExprNode& node : std::span(parsed.expressions).subspan(statements[i].first, statements[i].count))
+            if (node.kind != ExprKind::INT_LIT && node.kind != ExprKind::IDENT && node.kind != ExprKind::STR_LIT)
+                node.a = static_cast<std::uint32_t>(node.a + delta);
+    }
+    for (std::size_t i = first; i < resync; i++)
+        garbage += statements[i].count;
+    statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(first), statements.begin() + static_cast<std::ptrdiff_t>(resync));
+    statements.insert(statements.begin() + static_cast<std::ptrdiff_t>(first), fresh.begin(), fresh.end());
+    spans.erase(spans.begin() + static_cast<std::ptrdiff_t>(first), spans.begin() + static_cast<std::ptrdiff_t>(resync));
+    spans.insert(spans.begin() + static_cast<std::ptrdiff_t>(first), fresh_spans.begin(), fresh_spans.end());
+
+    /* Expression storage only grows; start over once dead nodes outnumber live ones */
+    if (garbage > parsed.expressions.size() - garbage)
+        reparse();
+    return fresh.size();
+}
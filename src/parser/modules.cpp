@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include <parser/modules.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+std::string HSharpParser::ModuleLoader::canonical(const std::string& path) {
+    std::error_code error;
+    const std::filesystem::path resolved = std::filesystem::weakly_canonical(path, error);
+    return error ? path : resolved.string();
+}
+
+bool HSharpParser::ModuleLoader::has_imports(const NodeProgram& program) {
+    return std::any_of(program.statements.begin(), program.statements.end(), [](const StmtNode& stmt) {
+        return stmt.kind == StmtKind::IMPORT;
+    });
+}
+
+void HSharpParser::ModuleLoader::parse(Module& module) {
+    std::optional<File> opened = File::open(module.path);
+    if (!opened.has_value())
+        return;
+    module.owned_file.emplace(std::move(opened.value()));
+    module.file = &module.owned_file.value();
+    Tokenizer tokenizer(module.owned_file.value(), module.owned_symbols);
+    Parser parser(tokenizer);
+    try {
+        module.owned_program = parser.parse_program(&module.arena);
+    } catch (const SyntaxError& error) {
+        module.error = error;
+        return;
+    }
+    module.symbols = &module.owned_symbols;
+    module.program = &module.owned_program.value();
+}
+
+std::size_t HSharpParser::ModuleLoader::schedule_imports(const std::size_t index) {
+    std::size_t scheduled = 0;
+    const ProgramView view = modules[index]->program->view();
+    const std::filesystem::path directory = std::filesystem::path(modules[index]->path).parent_path();
+    for (const StmtNode& stmt : view.statements) {
+        if (stmt.kind != StmtKind::IMPORT)
+            continue;
+        std::string path = canonical((directory / view.string(view.expressions[stmt.first])).string());
+        auto [found, inserted] = by_path.try_emplace(path, modules.size());
+        modules[index]->imports.push_back(found->second);
+        if (!inserted)
+            continue;
+        Module& module = *modules.emplace_back(std::make_unique<Module>());
+        module.path = std::move(path);
+        const std::size_t imported = found->second;
+        pool.submit([this, imported, &module] {
+            parse(module);
+            {
+                std::lock_guard lock(done_mutex);
+                done.push_back(imported);
+            }
+            done_available.notify_one();
+        });
+        scheduled++;
+    }
+    return scheduled;
+}
+
+std::optional<HSharpParser::NodeProgram> HSharpParser::ModuleLoader::load(const File& root_file, const NodeProgram& root,
+                                                                         SymbolTable& symbols,
+                                                                         std::pmr::memory_resource* resource) {
+    Module& module = *modules.emplace_back(std::make_unique<Module>());
+    module.path = canonical(root_file.name());
+    module.file = &root_file;
+    module.program = &root;
+    module.symbols = &symbols;
+    by_path.emplace(module.path, 0);
+
+    /* Imports are only known once their importer is parsed, so the graph is discovered as
+     * tasks finish; every task must finish before returning, even after a failure */
+    bool failed = false;
+    std::size_t outstanding = schedule_imports(0);
+    while (outstanding > 0) {
+        std::size_t index;
+        {
+            std::unique_lock lock(done_mutex);
+            done_available.wait(lock, [this] { return !done.empty(); });
+            index = done.back();
+            done.pop_back();
+        }
+        outstanding--;
+        if (modules[index]->error) {
+            std::cerr << modules[index]->error->what() << '\n';
+            failed = true;
+        } else if (!modules[index]->program) {
+            std::cerr << "Cannot import " << modules[index]->path << '\n';
+            failed = true;
+        } else if (!failed) {
+            outstanding += schedule_imports(index);
+        }
+    }
+    if (failed)
+        return {};
+
+    NodeProgram program(resource);
+    link(0, program, symbols);
+    return program;
+}
+
+void HSharpParser::ModuleLoader::link(const std::size_t index, NodeProgram& out, SymbolTable& symbols) {
+    Module& module = *modules[index];
+    module.linked = true;
+    const NodeProgram& program = *module.program;
+    std::vector<std::uint32_t> ids(module.symbols->size());
+    for (std::uint32_t id = 0; id < ids.size(); id++)
+        ids[id] = module.symbols == &symbols ? id : symbols.intern(module.symbols->name(id));
+
+    /* The module's nodes and string data go in whole, then its statements are rebased onto them */
+    const auto expression_base = static_cast<std::uint32_t>(out.expressions.size());
+    const auto string_base = static_cast<std::uint32_t>(out.string_data.size());
+    out.string_data.append(program.string_data);
+    for (ExprNode node : program.expressions) {
+        if (node.kind == ExprKind::IDENT)
+            node.a = ids[node.a];
+        else if (node.kind == ExprKind::STR_LIT)
+            node.a += string_base;
+        out.expressions.push_back(node);
+    }
+
+    std::size_t next_import = 0;
+    for (std::size_t i = 0; i < program.statements.size(); i++) {
+        StmtNode stmt = program.statements[i];
+        if (stmt.kind == StmtKind::IMPORT) {
+            const std::size_t imported = module.imports[next_import++];
+            if (!modules[imported]->linked)
+                link(imported, out, symbols);
+            continue;
+        }
+        stmt.first += expression_base;
+        if (stmt.kind == StmtKind::VAR || stmt.kind == StmtKind::ASSIGN)
+            stmt.symbol = ids[stmt.symbol];
+        out.statements.push_back(stmt);
+        out.spans.push_back(program.spans[i]);
+    }
+}
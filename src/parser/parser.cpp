@@ -1,215 +1,357 @@
+#include <algorithm>
+#include <charconv>
+#include <functional>
 #include <optional>
 #include <iostream>
-#include <ranges>
-#include <valarray>
+#include <unordered_map>
+#include <utility>
 
 #include <parser/parser.hpp>
-#include <arena_alloc/arena.hpp>
 
-std::optional<HSharpParser::NodeBinExpr *> HSharpParser::Parser::parse_bin_expr() {
-    if (auto lhs = parse_expression()) {
-        auto bin_expr = allocator.alloc<NodeBinExpr>();
-        if (peek().has_value() && peek().value().ttype == TokenType::TOK_PLUS) {
+namespace {
+    /* Binding power of binary operators; 0 for any other token. All of them are left-associative. */
+    constexpr int binary_precedence(const HSharpParser::TokenType ttype) {
+        switch (ttype) {
+            case HSharpParser::TokenType::TOK_PLUS:
+            case HSharpParser::TokenType::TOK_MINUS:
+                return 1;
+            case HSharpParser::TokenType::TOK_MUL_SIGN:
+            case HSharpParser::TokenType::TOK_FSLASH:
+                return 2;
+            default:
+                return 0;
+        }
+    }
 
-        } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_MINUS) {
-            auto bin_expr_sub = allocator.alloc<NodeBinExprSub>();
-            bin_expr_sub->lhs = lhs.value();
-            consume();
-            if (auto rhs = parse_expression()) {
-                bin_expr_sub->rhs = rhs.value();
-                bin_expr->var = bin_expr_sub;
-                return bin_expr;
-            } else {
-                std::cerr << "Cannot parse binary expression: invalid expression" << std::endl;
-                exit(1);
+    HSharpParser::ExprNode operator_node(const HSharpParser::Token& op) {
+        using HSharpParser::ExprKind;
+        switch (op.ttype) {
+            case HSharpParser::TokenType::TOK_PLUS: return {ExprKind::ADD, op.offset};
+            case HSharpParser::TokenType::TOK_MINUS: return {ExprKind::SUB, op.offset};
+            case HSharpParser::TokenType::TOK_MUL_SIGN: return {ExprKind::MUL, op.offset};
+            case HSharpParser::TokenType::TOK_FSLASH: return {ExprKind::DIV, op.offset};
+            default: std::unreachable();
+        }
+    }
+
+    /* The value the VE would compute, or nothing where it would fail or overflow at run time.
+     * Division by zero is left for the VE so that the error still happens, and in order;
+     * overflow, INT64_MIN / -1 included, so that its wrap-around is only defined there. */
+    std::optional<std::int64_t> fold(const HSharpParser::ExprKind kind, const std::int64_t left, const std::int64_t right) {
+        using HSharpParser::ExprKind;
+        std::int64_t result;
+        switch (kind) {
+            case ExprKind::ADD: if (__builtin_add_overflow(left, right, &result)) return {}; return result;
+            case ExprKind::SUB: if (__builtin_sub_overflow(left, right, &result)) return {}; return result;
+            case ExprKind::MUL: if (__builtin_mul_overflow(left, right, &result)) return {}; return result;
+            case ExprKind::DIV:
+                if (right == 0 || (left == INT64_MIN && right == -1))
+                    return {};
+                return left / right;
+            default: std::unreachable();
+        }
+    }
+}
+
+namespace {
+    /* Hash-consing for parse_program(..., deduplicate): identical string literals share one slice
+     * of string_data, and statements with identical expressions share one run of nodes, which
+     * turns the program into a DAG. Runs are shared whole because a postorder run is evaluated
+     * as one contiguous sweep; with constants folded, that is where the repetition is anyway. */
+    class ExpressionInterner {
+    private:
+        /* Content hash to (offset, length) in string_data */
+        std::unordered_multimap<std::size_t, std::pair<std::uint32_t, std::uint32_t>> strings;
+        /* Run hash to (first, count) in expressions */
+        std::unordered_multimap<std::uint64_t, std::pair<std::uint32_t, std::uint32_t>> runs;
+
+        /* Operator offsets only serve diagnostics, so they do not make two runs different */
+        static bool same_node(const HSharpParser::ExprNode& x, const HSharpParser::ExprNode& y) {
+            using HSharpParser::ExprKind;
+            const bool is_operator = x.kind != ExprKind::INT_LIT && x.kind != ExprKind::IDENT && x.kind != ExprKind::STR_LIT;
+            return x.kind == y.kind && (is_operator || (x.a == y.a && x.b == y.b));
+        }
+
+        static std::uint64_t hash_run(const std::span<const HSharpParser::ExprNode> run) {
+            using HSharpParser::ExprKind;
+            std::uint64_t state = 0xcbf29ce484222325ull ^ run.size();
+            for (const HSharpParser::ExprNode& node : run) {
+                const bool is_operator = node.kind != ExprKind::INT_LIT && node.kind != ExprKind::IDENT &&
+                                         node.kind != ExprKind::STR_LIT;
+                const std::uint64_t operands = is_operator ? 0 : (static_cast<std::uint64_t>(node.b) << 32 | node.a);
+                state = (state ^ static_cast<std::uint64_t>(node.kind)) * 0x100000001b3ull;
+                state = (state ^ operands) * 0xff51afd7ed558ccdull;
+                state ^= state >> 29;
             }
-        } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_MUL_SIGN) {
-            auto bin_expr_mul = allocator.alloc<NodeBinExprMul>();
-            bin_expr_mul->lhs = lhs.value();
-            consume();
-            if (auto rhs = parse_expression()) {
-                bin_expr_mul->rhs = rhs.value();
-                bin_expr->var = bin_expr_mul;
-                return bin_expr;
-            } else {
-                std::cerr << "Cannot parse binary expression: invalid expression" << std::endl;
-                exit(1);
+            return state;
+        }
+
+        /* Points the statement's STR_LIT nodes at earlier copies of their text and compacts the
+         * text that is new; string_mark is where this statement's string data starts */
+        void share_strings(HSharpParser::NodeProgram& program, const HSharpParser::StmtNode& stmt,
+                           const std::size_t string_mark) {
+            std::size_t write = string_mark;
+            for (HSharpParser::ExprNode& node : std::span(program.expressions).subspan(stmt.first, stmt.count)) {
+                if (node.kind != HSharpParser::ExprKind::STR_LIT)
+                    continue;
+                const std::string_view text = std::string_view(program.string_data).substr(node.a, node.b);
+                const std::size_t hash = std::hash<std::string_view>{}(text);
+                const auto [begin, end] = strings.equal_range(hash);
+                const auto match = std::find_if(begin, end, [&](const auto& entry) {
+                    return std::string_view(program.string_data).substr(entry.second.first, entry.second.second) == text;
+                });
+                if (match != end) {
+                    node.a = match->second.first;
+                    continue;
+                }
+                /* New text only ever moves down towards string_mark, where a forward copy is safe */
+                std::copy(text.begin(), text.end(), program.string_data.begin() + static_cast<std::ptrdiff_t>(write));
+                node.a = static_cast<std::uint32_t>(write);
+                strings.emplace(hash, std::pair{node.a, node.b});
+                write += node.b;
             }
-        } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_FSLASH) {
-            auto bin_expr_div = allocator.alloc<NodeBinExprDiv>();
-            bin_expr_div->lhs = lhs.value();
-            consume();
-            if (auto rhs = parse_expression()) {
-                bin_expr_div->rhs = rhs.value();
-                bin_expr->var = bin_expr_div;
-                return bin_expr;
-            } else {
-                std::cerr << "Cannot parse binary expression: invalid expression" << std::endl;
-                exit(1);
+            program.string_data.resize(write);
+        }
+
+    public:
+        /* Returns true if stmt now shares an earlier statement's nodes */
+        bool share(HSharpParser::NodeProgram& program, HSharpParser::StmtNode& stmt, const std::size_t string_mark) {
+            share_strings(program, stmt, string_mark);
+            const std::span<const HSharpParser::ExprNode> run = std::span(program.expressions).subspan(stmt.first, stmt.count);
+            const std::uint64_t hash = hash_run(run);
+            const auto [begin, end] = runs.equal_range(hash);
+            const auto match = std::find_if(begin, end, [&](const auto& entry) {
+                return entry.second.second == stmt.count &&
+                       std::equal(run.begin(), run.end(), program.expressions.begin() + entry.second.first, same_node);
+            });
+            if (match == end) {
+                runs.emplace(hash, std::pair{stmt.first, stmt.count});
+                return false;
+            }
+            program.expressions.resize(stmt.first);
+            stmt.first = match->second.first;
+            return true;
+        }
+    };
+}
+
+void HSharpParser::Parser::emit_operator(NodeProgram& program, const std::uint32_t first, const Token& op) {
+    const ExprNode node = operator_node(op);
+    /* In postorder the two nodes before an operator are its operands' roots; if both are
+     * literals they are the whole operands, and the three nodes collapse into one */
+    auto& expressions = program.expressions;
+    if (expressions.size() - first >= 2) {
+        const ExprNode& left = expressions[expressions.size() - 2];
+        const ExprNode& right = expressions.back();
+        if (left.kind == ExprKind::INT_LIT && right.kind == ExprKind::INT_LIT) {
+            if (const auto value = fold(node.kind, left.int_value(), right.int_value())) {
+                expressions.pop_back();
+                expressions.back() = ExprNode::int_lit(value.value());
+                folded++;
+                return;
             }
-        } else {
-            std::cerr << "Cannot parse binary expression: invalid expression" << std::endl;
-            exit(1);
         }
-    } else {
-        return {};
     }
+    expressions.push_back(node);
 }
 
-std::optional<HSharpParser::NodeTerm*> HSharpParser::Parser::parse_term() {
+bool HSharpParser::Parser::parse_operand(NodeProgram& program) {
     if (auto int_lit = try_consume(TokenType::TOK_INT_LIT)) {
-        auto term_int_lit = allocator.alloc<NodeTermIntLit>();
-        auto expr = allocator.alloc<NodeTerm>();
-        term_int_lit->int_lit = int_lit.value();
-        expr->term = term_int_lit;
-        return expr;
+        const std::string_view text = int_lit.value().text(stream.source_file().contents());
+        std::int64_t value;
+        if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc{})
+            fail("Integer literal is out of range", int_lit.value().offset);
+        program.expressions.push_back(ExprNode::int_lit(value));
+        return true;
     } else if (auto ident = try_consume(TokenType::TOK_IDENT)) {
-        auto term_ident = allocator.alloc<NodeTermIdent>();
-        auto expr = allocator.alloc<NodeTerm>();
-        term_ident->ident = ident.value();
-        expr->term = term_ident;
-        return expr;
+        program.expressions.push_back({ExprKind::IDENT, ident.value().symbol});
+        return true;
+    } else if (auto str_lit = try_consume(TokenType::TOK_STR_LIT)) {
+        const std::string_view value = str_lit.value().text(stream.source_file().contents());
+        program.expressions.push_back({ExprKind::STR_LIT, static_cast<std::uint32_t>(program.string_data.size()),
+                                       static_cast<std::uint32_t>(value.size())});
+        program.string_data.append(value);
+        return true;
     }
-    return {};
+    return false;
 }
 
+bool HSharpParser::Parser::parse_expression(NodeProgram& program, StmtNode& stmt) {
+    stmt.first = static_cast<std::uint32_t>(program.expressions.size());
+    operators.clear();
+    std::size_t open_parens = 0;
+    bool expect_operand = true;
+    while (true) {
+        if (expect_operand) {
+            if (auto paren = try_consume(TokenType::TOK_PAREN_OPEN)) {
+                /* Parentheses sit on the operator stack as a fence that reductions stop at */
+                operators.push_back(paren.value());
+                open_parens++;
+                continue;
+            }
+            if (!parse_operand(program)) {
+                /* Nothing consumed yet: let the caller decide whether an expression was required */
+                if (operators.empty())
+                    return false;
+                fail("Cannot parse expression: expected a value");
+            }
+            expect_operand = false;
+            continue;
+        }
 
-std::optional<HSharpParser::NodeExpression *> HSharpParser::Parser::parse_expression() {
-    if (auto term = parse_term()) {
-        if (try_consume(TokenType::TOK_PLUS)) {
-            auto bin_expr = allocator.alloc<NodeBinExpr>();
-            auto bin_expr_add = allocator.alloc<NodeBinExprAdd>();
-            auto lhs_expr = allocator.alloc<NodeExpression>();
-            lhs_expr->expr = term.value();
-            bin_expr_add->lhs = lhs_expr;
-            if (auto rhs = parse_expression()) {
-                bin_expr_add->rhs = rhs.value();
-                bin_expr->var = bin_expr_add;
-                auto expr = allocator.alloc<NodeExpression>();
-                expr->expr = bin_expr;
-                return expr;
-            } else {
-                std::cerr << "Cannot parse binary expression: invalid expression" << std::endl;
-                exit(1);
+        const Token* next = peek();
+        if (!next)
+            break;
+        if (const int precedence = binary_precedence(next->ttype)) {
+            /* Popping an operator emits it right after both of its operands: postorder */
+            while (!operators.empty() && binary_precedence(operators.back().ttype) >= precedence) {
+                emit_operator(program, stmt.first, operators.back());
+                operators.pop_back();
+            }
+            operators.push_back(consume());
+            expect_operand = true;
+        } else if (next->ttype == TokenType::TOK_PAREN_CLOSE && open_parens > 0) {
+            consume();
+            while (operators.back().ttype != TokenType::TOK_PAREN_OPEN) {
+                emit_operator(program, stmt.first, operators.back());
+                operators.pop_back();
             }
+            operators.pop_back();
+            open_parens--;
         } else {
-            auto expr = allocator.alloc<NodeExpression>();
-            expr->expr = term.value();
-            return expr;
+            /* Anything else, including a ')' closing a statement's own parenthesis, ends the expression */
+            break;
         }
-    } else if (auto str_lit = try_consume(TokenType::TOK_STR_LIT)) {
-        auto expr_str_lit = allocator.alloc<NodeExpressionStrLit>();
-        auto expr = allocator.alloc<NodeExpression>();
-        expr_str_lit->str_lit = str_lit.value();
-        expr->expr = expr_str_lit;
-        return expr;
-    } else if (auto bin_expr = parse_bin_expr()) {
-        auto expr = allocator.alloc<NodeExpression>();
-        expr->expr = bin_expr.value();
-        return expr;
-    } else
+    }
+    if (open_parens > 0)
+        fail("Expected ')'");
+    while (!operators.empty()) {
+        emit_operator(program, stmt.first, operators.back());
+        operators.pop_back();
+    }
+    stmt.count = static_cast<std::uint32_t>(program.expressions.size()) - stmt.first;
+    return true;
+}
+
+const std::array<HSharpParser::Parser::StatementRule, HSharpParser::token_type_count>
+HSharpParser::Parser::statement_rules = [] {
+    std::array<StatementRule, token_type_count> rules{};
+    rules[static_cast<std::size_t>(TokenType::TOK_EXIT)] = &Parser::parse_exit;
+    rules[static_cast<std::size_t>(TokenType::TOK_PRINT)] = &Parser::parse_print;
+    rules[static_cast<std::size_t>(TokenType::TOK_INPUT)] = &Parser::parse_input;
+    rules[static_cast<std::size_t>(TokenType::TOK_VAR)] = &Parser::parse_var;
+    rules[static_cast<std::size_t>(TokenType::TOK_IDENT)] = &Parser::parse_assign;
+    rules[static_cast<std::size_t>(TokenType::TOK_IMPORT)] = &Parser::parse_import;
+    return rules;
+}();
+
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_statement(NodeProgram& program) {
+    const Token* first = peek();
+    if (!first)
+        return {};
+    const StatementRule rule = statement_rules[static_cast<std::size_t>(first->ttype)];
+    if (!rule)
         return {};
+    return (this->*rule)(program);
 }
 
-std::optional<HSharpParser::NodeStmt *> HSharpParser::Parser::parse_statement() {
-    if (peek().has_value() && peek().value().ttype == TokenType::TOK_EXIT &&
-        peek(1).has_value() && peek(1).value().ttype == TokenType::TOK_PAREN_OPEN) {
-        consume();
-        consume();
-        auto stmt_exit = allocator.alloc<NodeStmtExit>();
-        if (auto node_expr = parse_expression()) {
-            stmt_exit->expr = node_expr.value();
-        } else {
-            std::cerr << "Evaluation of expression is impossible: invalid expression.\n";
-            exit(1);
-        }
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_call(NodeProgram& program, const StmtKind kind,
+                                                                       const char* invalid_expression) {
+    if (!next_is(TokenType::TOK_PAREN_OPEN, 1))
+        return {};
+    consume();
+    consume();
+    StmtNode stmt;
+    stmt.kind = kind;
+    if (!parse_expression(program, stmt))
+        fail(invalid_expression);
 
-        try_consume(TokenType::TOK_PAREN_CLOSE, "Expected ')'");
-        try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
-
-        auto node_stmt = allocator.alloc<NodeStmt>();
-        node_stmt->statement = stmt_exit;
-        return node_stmt;
-    } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_PRINT &&
-               peek(1).has_value() && peek(1).value().ttype == TokenType::TOK_PAREN_OPEN) {
-        consume();
-        consume();
-        auto stmt_print = allocator.alloc<NodeStmtPrint>();
-        if (auto expr = parse_expression())
-            stmt_print->expr = expr.value();
-
-        try_consume(TokenType::TOK_PAREN_CLOSE, "Expected ')'");
-        try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
-
-        auto node_stmt = allocator.alloc<NodeStmt>();
-        node_stmt->statement = stmt_print;
-        return node_stmt;
-    } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_INPUT &&
-               peek(1).has_value() && peek(1).value().ttype == TokenType::TOK_PAREN_OPEN) {
-        consume();
-        consume();
-        auto node_input = allocator.alloc<NodeStmtInput>();
-        if (auto expr = parse_expression())
-            node_input->expr = expr.value();
-
-        try_consume(TokenType::TOK_PAREN_CLOSE, "Expected ')'");
-        try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
-
-        auto node_stmt = allocator.alloc<NodeStmt>();
-        node_stmt->statement = node_input;
-        return node_stmt;
-    } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_VAR &&
-               peek(1).has_value() && peek(1).value().ttype == TokenType::TOK_IDENT &&
-               peek(2).has_value() && peek(2).value().ttype == TokenType::TOK_EQUALITY_SIGN) {
-        consume();
-        auto node_stmt_var = allocator.alloc<NodeStmtVar>();
-        node_stmt_var->ident = consume();
-        consume();
-        if (auto expr = parse_expression()) {
-            node_stmt_var->expr = expr.value();
-        } else {
-            std::cerr << "Invalid expression!\n";
-            exit(1);
-        }
+    try_consume(TokenType::TOK_PAREN_CLOSE, "Expected ')'");
+    try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
+    return stmt;
+}
 
-        try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
-
-        auto node_stmt = allocator.alloc<NodeStmt>();
-        node_stmt->statement = node_stmt_var;
-        return node_stmt;
-    } else if (peek().has_value() && peek().value().ttype == TokenType::TOK_IDENT &&
-                peek(1).has_value() && peek(1).value().ttype == TokenType::TOK_EQUALITY_SIGN) {
-        auto node_stmt = allocator.alloc<NodeStmtVarAssign>();
-        node_stmt->ident = consume();
-        consume();
-        if (auto expr = parse_expression())
-            node_stmt->expr = expr.value();
-        else {
-            std::cerr << "Failed to parse expression\n";
-            exit(1);
-        }
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_exit(NodeProgram& program) {
+    return parse_call(program, StmtKind::EXIT, "Evaluation of expression is impossible: invalid expression.");
+}
 
-        try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_print(NodeProgram& program) {
+    return parse_call(program, StmtKind::PRINT, "Invalid expression!");
+}
 
-        auto stmt = allocator.alloc<NodeStmt>();
-        stmt->statement = node_stmt;
-        return stmt;
-    } else {
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_input(NodeProgram& program) {
+    return parse_call(program, StmtKind::INPUT, "Invalid expression!");
+}
+
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_var(NodeProgram& program) {
+    if (!next_is(TokenType::TOK_IDENT, 1) || !next_is(TokenType::TOK_EQUALITY_SIGN, 2))
         return {};
-    }
+    consume();
+    StmtNode stmt;
+    stmt.kind = StmtKind::VAR;
+    stmt.symbol = consume().symbol;
+    consume();
+    if (!parse_expression(program, stmt))
+        fail("Invalid expression!");
+
+    try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
+    return stmt;
 }
 
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_assign(NodeProgram& program) {
+    if (!next_is(TokenType::TOK_EQUALITY_SIGN, 1))
+        return {};
+    StmtNode stmt;
+    stmt.kind = StmtKind::ASSIGN;
+    stmt.symbol = consume().symbol;
+    consume();
+    if (!parse_expression(program, stmt))
+        fail("Failed to parse expression");
+
+    try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
+    return stmt;
+}
 
-std::optional<HSharpParser::NodeProgram> HSharpParser::Parser::parse_program() {
-    NodeProgram program;
-    while (peek().has_value()) {
-        std::optional<NodeStmt *> stmt = parse_statement();
-        if (stmt.has_value()) {
-            program.statements.push_back(stmt.value());
-        } else {
-            std::cerr << "Invalid statement!\n";
-            exit(1);
-        }
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::parse_import(NodeProgram& program) {
+    consume();
+    StmtNode stmt;
+    stmt.kind = StmtKind::IMPORT;
+    stmt.first = static_cast<std::uint32_t>(program.expressions.size());
+    if (!next_is(TokenType::TOK_STR_LIT))
+        fail("Expected module path after 'import'");
+    parse_operand(program);
+    stmt.count = 1;
+    try_consume(TokenType::TOK_SEMICOLON, "Expected ';'");
+    return stmt;
+}
+
+
+std::optional<HSharpParser::StmtNode> HSharpParser::Parser::next_statement(NodeProgram& program, StatementSpan& span) {
+    const Token* first = peek();
+    if (!first)
+        return {};
+    const std::uint32_t begin = first->offset;
+    std::optional<StmtNode> stmt = parse_statement(program);
+    if (!stmt.has_value())
+        fail("Invalid statement!");
+    span = {.begin = begin, .end = consumed_end};
+    return stmt;
+}
+
+std::optional<HSharpParser::NodeProgram> HSharpParser::Parser::parse_program(std::pmr::memory_resource* resource,
+                                                                            const bool deduplicate) {
+    NodeProgram program(resource);
+    StatementSpan span{};
+    std::optional<ExpressionInterner> interner;
+    if (deduplicate)
+        interner.emplace();
+    std::size_t string_mark = 0;
+    while (auto stmt = next_statement(program, span)) {
+        if (interner && interner->share(program, stmt.value(), string_mark))
+            shared++;
+        string_mark = program.string_data.size();
+        program.statements.push_back(stmt.value());
+        program.spans.push_back(span);
     }
     return program;
-}
\ No newline at end of file
+}
@@ -0,0 +1,299 @@
+#include <bit>
+#include <cstring>
+#include <string_view>
+
+#include <parser/scan.hpp>
+#include <parser/lexer_tables.hpp>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HSHARP_SCAN_X86 1
+#endif
+
+using HSharpParser::Tables::CharClass;
+
+namespace {
+    /* Byte predicates shared by the scalar kernels and the vector tails */
+    struct WhitespaceClass {
+        static bool test(const char c) { return HSharpParser::Tables::char_info(c).cls == CharClass::SPACE; }
+    };
+    struct IdentTailClass {
+        static bool test(const char c) { return HSharpParser::Tables::is_ident_tail(c); }
+    };
+    struct DigitClass {
+        static bool test(const char c) { return HSharpParser::Tables::char_info(c).cls == CharClass::DIGIT; }
+    };
+
+    template<typename Class>
+    const char* scalar_skip(const char* cursor, const char* const end) {
+        while (cursor != end && Class::test(*cursor))
+            cursor++;
+        return cursor;
+    }
+
+    const char* scalar_skip_whitespace(const char* cursor, const char* end) { return scalar_skip<WhitespaceClass>(cursor, end); }
+    const char* scalar_skip_ident_tail(const char* cursor, const char* end) { return scalar_skip<IdentTailClass>(cursor, end); }
+    const char* scalar_skip_digits(const char* cursor, const char* end) { return scalar_skip<DigitClass>(cursor, end); }
+
+    const char* scalar_find_byte(const char* cursor, const char* end, const char byte) {
+        const void* found = std::memchr(cursor, byte, end - cursor);
+        return found ? static_cast<const char*>(found) : end;
+    }
+
+    std::size_t scalar_count_byte(const char* cursor, const char* const end, const char byte) {
+        std::size_t count = 0;
+        for (; cursor != end; cursor++)
+            count += *cursor == byte;
+        return count;
+    }
+
+    const char* scalar_find_comment_close(const char* cursor, const char* end) {
+        while (cursor != end) {
+            cursor = scalar_find_byte(cursor, end, '*');
+            if (cursor == end || cursor + 1 == end)
+                return end;
+            if (cursor[1] == '/')
+                return cursor;
+            cursor++;
+        }
+        return end;
+    }
+
+#ifdef HSHARP_SCAN_X86
+    /* SSE2 is part of the x86-64 baseline, so these need no target attribute */
+    namespace Sse2 {
+        /* Lanes where lo <= v <= hi, using an unsigned min against the shifted range */
+        inline __m128i in_range(const __m128i v, const char lo, const char hi) {
+            const __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+            return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(hi - lo))), shifted);
+        }
+        struct WhitespaceMask {
+            __m128i operator()(const __m128i v) const {
+                return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), in_range(v, '\t', '\r'));
+            }
+        };
+        struct IdentTailMask {
+            __m128i operator()(const __m128i v) const {
+                const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+                return _mm_or_si128(in_range(v, '0', '9'), in_range(lower, 'a', 'z'));
+            }
+        };
+        struct DigitMask {
+            __m128i operator()(const __m128i v) const { return in_range(v, '0', '9'); }
+        };
+
+        template<typename Mask, typename Class>
+        const char* skip(const char* cursor, const char* const end) {
+            while (end - cursor >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+                const auto outside = static_cast<std::uint32_t>(~_mm_movemask_epi8(Mask{}(chunk))) & 0xffffu;
+                if (outside)
+                    return cursor + std::countr_zero(outside);
+                cursor += 16;
+            }
+            return scalar_skip<Class>(cursor, end);
+        }
+
+        const char* skip_whitespace(const char* cursor, const char* end) { return skip<WhitespaceMask, WhitespaceClass>(cursor, end); }
+        const char* skip_ident_tail(const char* cursor, const char* end) { return skip<IdentTailMask, IdentTailClass>(cursor, end); }
+        const char* skip_digits(const char* cursor, const char* end) { return skip<DigitMask, DigitClass>(cursor, end); }
+
+        const char* find_byte(const char* cursor, const char* const end, const char byte) {
+            const __m128i needle = _mm_set1_epi8(byte);
+            while (end - cursor >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+                const auto hits = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+                if (hits)
+                    return cursor + std::countr_zero(hits);
+                cursor += 16;
+            }
+            return scalar_find_byte(cursor, end, byte);
+        }
+
+        std::size_t count_byte(const char* cursor, const char* const end, const char byte) {
+            const __m128i needle = _mm_set1_epi8(byte);
+            std::size_t count = 0;
+            while (end - cursor >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+                count += std::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle))));
+                cursor += 16;
+            }
+            return count + scalar_count_byte(cursor, end, byte);
+        }
+
+        const char* find_comment_close(const char* cursor, const char* const end) {
+            const __m128i star = _mm_set1_epi8('*');
+            const __m128i slash = _mm_set1_epi8('/');
+            while (end - cursor >= 17) {
+                const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+                const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor + 1));
+                const __m128i pairs = _mm_and_si128(_mm_cmpeq_epi8(current, star), _mm_cmpeq_epi8(next, slash));
+                const auto hits = static_cast<std::uint32_t>(_mm_movemask_epi8(pairs));
+                if (hits)
+                    return cursor + std::countr_zero(hits);
+                cursor += 16;
+            }
+            return scalar_find_comment_close(cursor, end);
+        }
+    }
+
+    namespace Avx2 {
+        __attribute__((target("avx2"))) inline __m256i in_range(const __m256i v, const char lo, const char hi) {
+            const __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+            return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(hi - lo))), shifted);
+        }
+        struct WhitespaceMask {
+            __attribute__((target("avx2"))) __m256i operator()(const __m256i v) const {
+                return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), in_range(v, '\t', '\r'));
+            }
+        };
+        struct IdentTailMask {
+            __attribute__((target("avx2"))) __m256i operator()(const __m256i v) const {
+                const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+                return _mm256_or_si256(in_range(v, '0', '9'), in_range(lower, 'a', 'z'));
+            }
+        };
+        struct DigitMask {
+            __attribute__((target("avx2"))) __m256i operator()(const __m256i v) const { return in_range(v, '0', '9'); }
+        };
+
+        template<typename Mask, typename Class>
+        __attribute__((target("avx2"))) const char* skip(const char* cursor, const char* const end) {
+            while (end - cursor >= 32) {
+                const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+                const auto outside = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(Mask{}(chunk)));
+                if (outside)
+                    return cursor + std::countr_zero(outside);
+                cursor += 32;
+            }
+            return scalar_skip<Class>(cursor, end);
+        }
+
+        __attribute__((target("avx2"))) const char* skip_whitespace(const char* cursor, const char* end) {
+            return skip<WhitespaceMask, WhitespaceClass>(cursor, end);
+        }
+        __attribute__((target("avx2"))) const char* skip_ident_tail(const char* cursor, const char* end) {
+            return skip<IdentTailMask, IdentTailClass>(cursor, end);
+        }
+        __attribute__((target("avx2"))) const char* skip_digits(const char* cursor, const char* end) {
+            return skip<DigitMask, DigitClass>(cursor, end);
+        }
+
+        __attribute__((target("avx2"))) const char* find_byte(const char* cursor, const char* const end, const char byte) {
+            const __m256i needle = _mm256_set1_epi8(byte);
+            while (end - cursor >= 32) {
+                const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+                const auto hits = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+                if (hits)
+                    return cursor + std::countr_zero(hits);
+                cursor += 32;
+            }
+            return Sse2::find_byte(cursor, end, byte);
+        }
+
+        __attribute__((target("avx2"))) std::size_t count_byte(const char* cursor, const char* const end, const char byte) {
+            const __m256i needle = _mm256_set1_epi8(byte);
+            std::size_t count = 0;
+            while (end - cursor >= 32) {
+                const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+                count += std::popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle))));
+                cursor += 32;
+            }
+            return count + Sse2::count_byte(cursor, end, byte);
+        }
+
+        __attribute__((target("avx2"))) const char* find_comment_close(const char* cursor, const char* const end) {
+            const __m256i star = _mm256_set1_epi8('*');
+            const __m256i slash = _mm256_set1_epi8('/');
+            while (end - cursor >= 33) {
+                const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+                const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor + 1));
+                const __m256i pairs = _mm256_and_si256(_mm256_cmpeq_epi8(current, star), _mm256_cmpeq_epi8(next, slash));
+                const auto hits = static_cast<std::uint32_t>(_mm256_movemask_epi8(pairs));
+                if (hits)
+                    return cursor + std::countr_zero(hits);
+                cursor += 32;
+            }
+            return Sse2::find_comment_close(cursor, end);
+        }
+    }
+#endif
+
+    struct Kernels {
+        std::string_view name;
+        const char* (*skip_whitespace)(const char*, const char*);
+        const char* (*skip_ident_tail)(const char*, const char*);
+        const char* (*skip_digits)(const char*, const char*);
+        const char* (*find_byte)(const char*, const char*, char);
+        std::size_t (*count_byte)(const char*, const char*, char);
+        const char* (*find_comment_close)(const char*, const char*);
+    };
+
+    constexpr Kernels scalar_kernels{"scalar", scalar_skip_whitespace, scalar_skip_ident_tail, scalar_skip_digits,
+                                     scalar_find_byte, scalar_count_byte, scalar_find_comment_close};
+#ifdef HSHARP_SCAN_X86
+    constexpr Kernels sse2_kernels{"sse2", Sse2::skip_whitespace, Sse2::skip_ident_tail, Sse2::skip_digits,
+                                   Sse2::find_byte, Sse2::count_byte, Sse2::find_comment_close};
+    constexpr Kernels avx2_kernels{"avx2", Avx2::skip_whitespace, Avx2::skip_ident_tail, Avx2::skip_digits,
+                                   Avx2::find_byte, Avx2::count_byte, Avx2::find_comment_close};
+#endif
+
+    const Kernels* detect_kernels() {
+#ifdef HSHARP_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &avx2_kernels;
+        return &sse2_kernels;
+#else
+        return &scalar_kernels;
+#endif
+    }
+
+    const Kernels* active = detect_kernels();
+}
+
+const char* HSharpParser::Scan::skip_whitespace(const char* cursor, const char* end) {
+    return active->skip_whitespace(cursor, end);
+}
+
+const char* HSharpParser::Scan::skip_ident_tail(const char* cursor, const char* end) {
+    return active->skip_ident_tail(cursor, end);
+}
+
+const char* HSharpParser::Scan::skip_digits(const char* cursor, const char* end) {
+    return active->skip_digits(cursor, end);
+}
+
+const char* HSharpParser::Scan::find_byte(const char* cursor, const char* end, const char byte) {
+    return active->find_byte(cursor, end, byte);
+}
+
+std::size_t HSharpParser::Scan::count_byte(const char* cursor, const char* end, const char byte) {
+    return active->count_byte(cursor, end, byte);
+}
+
+const char* HSharpParser::Scan::find_comment_close(const char* cursor, const char* end) {
+    return active->find_comment_close(cursor, end);
+}
+
+std::string_view HSharpParser::Scan::active_kernels() {
+    return active->name;
+}
+
+bool HSharpParser::Scan::select_kernels(const std::string_view name) {
+    if (name == scalar_kernels.name) {
+        active = &scalar_kernels;
+        return true;
+    }
+#ifdef HSHARP_SCAN_X86
+    if (name == sse2_kernels.name) {
+        active = &sse2_kernels;
+        return true;
+    }
+    if (name == avx2_kernels.name && __builtin_cpu_supports("avx2")) {
+        active = &avx2_kernels;
+        return true;
+    }
+#endif
+    return false;
+}
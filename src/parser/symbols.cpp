@@ -0,0 +1,49 @@
+#include <parser/symbols.hpp>
+
+std::string_view HSharpParser::SymbolTable::store(const std::string_view name) {
+    auto destination = static_cast<char*>(names.allocate_bytes(name.size(), 1));
+    std::memcpy(destination, name.data(), name.size());
+    return {destination, name.size()};
+}
+
+void HSharpParser::SymbolTable::grow() {
+    std::vector<std::uint32_t> resized(slots.size() * 2);
+    const std::size_t mask = resized.size() - 1;
+    for (std::uint32_t id = 0; id < entries.size(); id++) {
+        std::size_t slot = entries[id].hash & mask;
+        while (resized[slot])
+            slot = (slot + 1) & mask;
+        resized[slot] = id + 1;
+    }
+    slots = std::move(resized);
+}
+
+std::uint32_t HSharpParser::SymbolTable::intern(const std::string_view name, const std::uint32_t hash) {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t slot = hash & mask;
+    while (const std::uint32_t occupant = slots[slot]) {
+        const Entry& entry = entries[occupant - 1];
+        if (entry.hash == hash && entry.name == name)
+            return occupant - 1;
+        slot = (slot + 1) & mask;
+    }
+
+    const auto id = static_cast<std::uint32_t>(entries.size());
+    entries.push_back({store(name), hash});
+    slots[slot] = id + 1;
+    /* Keep the load factor at or below one half */
+    if (entries.size() * 2 > slots.size())
+        grow();
+    return id;
+}
+
+std::optional<std::uint32_t> HSharpParser::SymbolTable::find(const std::string_view name) const {
+    const std::uint32_t hashed = hash(name);
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t slot = hashed & mask; slots[slot]; slot = (slot + 1) & mask) {
+        const Entry& entry = entries[slots[slot] - 1];
+        if (entry.hash == hashed && entry.name == name)
+            return slots[slot] - 1;
+    }
+    return {};
+}
@@ -1,101 +1,263 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <future>
+#include <algorithm>
 
 #include <parser/parser.hpp>
+#include <parser/lexer_tables.hpp>
+#include <parser/scan.hpp>
 #include <main/file.hpp>
+#include <thread_pool/thread_pool.hpp>
 
 using std::uint32_t;
 using HSharpParser::Token;
+using HSharpParser::Tables::CharClass;
 
-std::vector<Token> HSharpParser::Tokenizer::tokenize() {
-    std::string buf = {};
-    std::vector<Token> tokens = {};
-
-    while (peek().has_value()) {
-        if (std::isalpha(peek().value())) {
-            buf.push_back(consume());
-            while (peek().has_value() && std::isalnum(peek().value()))
-                buf.push_back(consume());
-
-            if (buf == "exit") {
-                tokens.push_back({.ttype = TokenType::TOK_EXIT});
-                buf.clear();
-            } else if (buf == "var") {
-                tokens.push_back({.ttype = TokenType::TOK_VAR});
-                buf.clear();
-            } else if (buf == "print") {
-                tokens.push_back({.ttype = TokenType::TOK_PRINT});
-                buf.clear();
-            } else if (buf == "input") {
-                tokens.push_back({.ttype = TokenType::TOK_INPUT});
-                buf.clear();
-            } else {
-                tokens.push_back({.ttype = TokenType::TOK_IDENT, .value = buf});
-                buf.clear();
-            }
-        } else if (peek().value() == '"') {
-            consume();
-            while (peek().has_value() && peek().value() != '"')
-                buf.push_back(consume());
-            consume();
-            tokens.push_back({.ttype = TokenType::TOK_STR_LIT, .value = buf});
-            buf.clear();
-        } else if (std::isdigit(peek().value())) {
-            buf.push_back(consume());
-            while (peek().has_value() && std::isdigit(peek().value()))
-                buf.push_back(consume());
-            tokens.push_back({.ttype = TokenType::TOK_INT_LIT, .value = buf});
-            buf.clear();
-        } else if (peek().value() == ';') {
-            tokens.push_back({.ttype = TokenType::TOK_SEMICOLON});
-            consume();
-        } else if (peek().value() == '(') {
-            tokens.push_back({.ttype = TokenType::TOK_PAREN_OPEN});
-            consume();
-        } else if (peek().value() == ')') {
-            tokens.push_back({.ttype = TokenType::TOK_PAREN_CLOSE});
-            consume();
-        } else if (peek().value() == '=') {
-            tokens.push_back({.ttype = TokenType::TOK_EQUALITY_SIGN});
-            consume();
-        } else if (peek().value() == '+') {
-            tokens.push_back({.ttype = TokenType::TOK_PLUS});
-            consume();
-        } else if (peek().value() == '-') {
-            tokens.push_back({.ttype = TokenType::TOK_MINUS});
-            consume();
-        } else if (peek().value() == '/') {
-            tokens.push_back({.ttype = TokenType::TOK_FSLASH});
-            consume();
-        } else if (peek().value() == '*') {
-            tokens.push_back({.ttype = TokenType::TOK_MUL_SIGN});
-            consume();
-        } else if (peek().value() == '/' && peek(1).has_value() && peek(1).value() == '/') {
-            consume();
-            consume();
-            while (peek().has_value() && peek().value() != '\n')
-                consume();
-        } else if (peek().value() == '/' && peek(1).has_value() && peek(1).value() == '*') {
-            consume();
-            consume();
-            while (peek().has_value()) {
-                if (peek().value() == '*' && peek(1).has_value() && peek(1).value() == '/')
+namespace {
+    using namespace HSharpParser;
+
+    enum class LexResult {
+        TOKEN,
+        END,
+        UNEXPECTED_CHARACTER,
+        UNTERMINATED_STRING,
+        UNTERMINATED_COMMENT
+    };
+
+    /* Shared by next() and tokenize(); kept inline so the bulk loop keeps its cursor in registers.
+     * On failure cursor is left on the offending character or on the opening delimiter. */
+    [[gnu::always_inline]] inline LexResult lex_token(const char*& cursor, const char* const begin, const char* const end, Token& token) {
+        while (cursor != end) {
+            const auto start = static_cast<uint32_t>(cursor - begin);
+            const Tables::CharInfo& info = Tables::char_info(*cursor);
+            switch (info.cls) {
+                case CharClass::SPACE:
+                    /* Single separators are the common case, only hand real runs to the kernel */
+                    if (++cursor != end && Tables::char_info(*cursor).cls == CharClass::SPACE)
+                        cursor = Scan::skip_whitespace(cursor, end);
+                    continue;
+                case CharClass::ALPHA: {
+                    cursor = Scan::skip_ident_tail(cursor + 1, end);
+                    const auto length = static_cast<uint32_t>(cursor - begin) - start;
+                    const std::string_view word{begin + start, length};
+                    if (const auto keyword = Tables::lookup_keyword(word))
+                        token = {.ttype = keyword.value(), .offset = start, .length = length};
+                    else
+                        token = {.ttype = TokenType::TOK_IDENT, .offset = start, .length = length, .hash = SymbolTable::hash(word)};
+                    break;
+                }
+                case CharClass::DIGIT:
+                    cursor = Scan::skip_digits(cursor + 1, end);
+                    token = {.ttype = TokenType::TOK_INT_LIT, .offset = start, .length = static_cast<uint32_t>(cursor - begin) - start};
+                    break;
+                case CharClass::QUOTE:
+                    cursor = Scan::find_byte(cursor + 1, end, '"');
+                    if (cursor == end) {
+                        cursor = begin + start;
+                        return LexResult::UNTERMINATED_STRING;
+                    }
+                    /* The token covers the literal's contents, without the quotes */
+                    token = {.ttype = TokenType::TOK_STR_LIT, .offset = start + 1, .length = static_cast<uint32_t>(cursor - begin) - start - 1};
+                    cursor++;
+                    break;
+                case CharClass::SLASH:
+                    if (cursor + 1 != end && cursor[1] == '/') {
+                        cursor = Scan::find_byte(cursor + 2, end, '\n');
+                        continue;
+                    } else if (cursor + 1 != end && cursor[1] == '*') {
+                        cursor = Scan::find_comment_close(cursor + 2, end);
+                        if (cursor == end) {
+                            cursor = begin + start;
+                            return LexResult::UNTERMINATED_COMMENT;
+                        }
+                        cursor += 2;
+                        continue;
+                    }
+                    [[fallthrough]];
+                case CharClass::PUNCT:
+                    token = {.ttype = info.token, .offset = start, .length = 1};
+                    cursor++;
                     break;
-                consume();
+                default:
+                    return LexResult::UNEXPECTED_CHARACTER;
             }
-            if (peek().has_value())
-                consume();
-            if (peek().has_value())
-                consume();
-        } else if (std::isspace(peek().value())) {
-            consume();
-        } else {
-            std::cerr << "Syntax error!\n";
-            exit(1);
+            return LexResult::TOKEN;
         }
+        return LexResult::END;
+    }
+
+    /* String literal tokens exclude the opening quote; this is where lexing of a token began */
+    uint32_t lexeme_start(const Token& token) {
+        return token.ttype == TokenType::TOK_STR_LIT ? token.offset - 1 : token.offset;
+    }
+
+    /* Result of lexing one chunk speculatively, assuming its first byte is between tokens */
+    struct LexedChunk {
+        std::vector<Token> tokens;
+        uint32_t resume = 0;
+        LexResult result = LexResult::END;
+    };
+
+    /* Lexes tokens starting in [start, limit); the last one may run past limit. Lexing stops at
+     * the first error, which only matters if the merge later proves this chunk was in sync. */
+    LexedChunk lex_chunk(const std::string_view source, const uint32_t start, const uint32_t limit) {
+        const char* const begin = source.data();
+        const char* const end = begin + source.size();
+        const char* cursor = begin + start;
+        LexedChunk chunk;
+        chunk.tokens.reserve((limit - start) / 4);
+        Token token;
+        while (true) {
+            const char* const before = cursor;
+            chunk.result = lex_token(cursor, begin, end, token);
+            if (chunk.result == LexResult::TOKEN && lexeme_start(token) >= limit) {
+                /* Belongs to the next chunk; leave the cursor between tokens */
+                cursor = before;
+                chunk.result = LexResult::END;
+            }
+            if (chunk.result != LexResult::TOKEN)
+                break;
+            chunk.tokens.push_back(token);
+        }
+        chunk.resume = static_cast<uint32_t>(cursor - begin);
+        return chunk;
+    }
+
+    [[noreturn]] void report_lex_error(const File& file, const LexResult result, const uint32_t offset) {
+        std::string message = file.describe(offset) + ": ";
+        switch (result) {
+            case LexResult::UNTERMINATED_STRING: message += "Unterminated string literal!"; break;
+            case LexResult::UNTERMINATED_COMMENT: message += "Unterminated comment!"; break;
+            default: message += "Syntax error: unexpected character '" + std::string(1, file.contents()[offset]) + "'"; break;
+        }
+        throw HSharpParser::SyntaxError(message);
+    }
+}
+
+bool HSharpParser::Tokenizer::next(Token& token) {
+    const char* cursor = source.data() + index;
+    const LexResult result = lex_token(cursor, source.data(), source.data() + source.size(), token);
+    index = static_cast<uint32_t>(cursor - source.data());
+    if (result == LexResult::TOKEN) {
+        if (token.ttype == TokenType::TOK_IDENT)
+            token.symbol = symbols.intern(token.text(source), token.hash);
+        return true;
+    }
+    if (result != LexResult::END)
+        report_lex_error(file, result, index);
+    return false;
+}
+
+std::pmr::vector<Token> HSharpParser::Tokenizer::tokenize(std::pmr::memory_resource* resource) {
+    std::pmr::vector<Token> tokens(resource);
+    /* Rough guess of one token per 4 bytes of source to avoid most regrowth */
+    tokens.reserve(source.size() / 4);
+
+    const char* cursor = source.data() + index;
+    Token token;
+    LexResult result;
+    while ((result = lex_token(cursor, source.data(), source.data() + source.size(), token)) == LexResult::TOKEN) {
+        if (token.ttype == TokenType::TOK_IDENT)
+            token.symbol = symbols.intern(token.text(source), token.hash);
+        tokens.push_back(token);
     }
+    if (result != LexResult::END)
+        report_lex_error(file, result, static_cast<uint32_t>(cursor - source.data()));
 
     index = 0;
     return tokens;
 }
+
+std::pmr::vector<Token> HSharpParser::Tokenizer::tokenize(ThreadPool& pool, std::pmr::memory_resource* resource) {
+    const std::size_t chunk_count = std::min(pool.size() * 4, source.size() / min_parallel_chunk);
+    if (chunk_count < 2 || index != 0)
+        return tokenize(resource);
+
+    std::pmr::vector<Token> tokens = lex_parallel(pool, chunk_count, resource);
+    /* Chunks hash identifiers but interning stays serial so ids come out in source order,
+     * exactly as the serial path assigns them */
+    for (Token& token : tokens)
+        if (token.ttype == TokenType::TOK_IDENT)
+            token.symbol = symbols.intern(token.text(source), token.hash);
+    return tokens;
+}
+
+std::pmr::vector<Token> HSharpParser::Tokenizer::lex_parallel(ThreadPool& pool, const std::size_t chunk_count,
+                                                               std::pmr::memory_resource* resource) {
+    /* Chunk starts are nudged past a newline, which is a token boundary unless it sits inside a
+     * string literal or block comment. Those misses are repaired while merging. */
+    std::vector<uint32_t> starts = {0};
+    for (std::size_t i = 1; i < chunk_count; i++) {
+        const char* nominal = source.data() + source.size() * i / chunk_count;
+        const char* newline = Scan::find_byte(nominal, source.data() + source.size(), '\n');
+        const auto start = static_cast<uint32_t>(std::min<std::size_t>(newline - source.data() + 1, source.size()));
+        if (start > starts.back() && start < source.size())
+            starts.push_back(start);
+    }
+
+    std::vector<std::future<LexedChunk>> pending;
+    pending.reserve(starts.size());
+    for (std::size_t i = 0; i < starts.size(); i++) {
+        const uint32_t limit = i + 1 < starts.size() ? starts[i + 1] : static_cast<uint32_t>(source.size());
+        pending.push_back(pool.submit([this, start = starts[i], limit] { return lex_chunk(source, start, limit); }));
+    }
+
+    std::vector<LexedChunk> chunks;
+    chunks.reserve(pending.size());
+    std::size_t total = 0;
+    for (auto& chunk : pending) {
+        chunks.push_back(chunk.get());
+        total += chunks.back().tokens.size();
+    }
+
+    std::pmr::vector<Token> tokens(resource);
+    tokens.reserve(total);
+    tokens.insert(tokens.end(), chunks[0].tokens.begin(), chunks[0].tokens.end());
+    if (chunks[0].result != LexResult::END)
+        report_lex_error(file, chunks[0].result, chunks[0].resume);
+
+    /* Merge: from where the previous (correct) output stops, lex serially until a lexeme starts
+     * exactly where the speculative run of the next chunk also started one. Lexing from a token
+     * start is context free, so everything the chunk produced from there on is adopted as is. */
+    const char* const begin = source.data();
+    const char* const end = begin + source.size();
+    const char* cursor = begin + chunks[0].resume;
+    for (std::size_t i = 1; i < chunks.size(); i++) {
+        const LexedChunk& chunk = chunks[i];
+        const uint32_t limit = i + 1 < chunks.size() ? starts[i + 1] : static_cast<uint32_t>(source.size());
+        std::size_t candidate = 0;
+        while (true) {
+            Token token;
+            const LexResult result = lex_token(cursor, begin, end, token);
+            if (result == LexResult::END)
+                return tokens;
+            if (result != LexResult::TOKEN)
+                report_lex_error(file, result, static_cast<uint32_t>(cursor - begin));
+
+            const uint32_t start = lexeme_start(token);
+            while (candidate < chunk.tokens.size() && lexeme_start(chunk.tokens[candidate]) < start)
+                candidate++;
+            if (candidate < chunk.tokens.size() && lexeme_start(chunk.tokens[candidate]) == start) {
+                tokens.insert(tokens.end(), chunk.tokens.begin() + static_cast<std::ptrdiff_t>(candidate), chunk.tokens.end());
+                cursor = begin + chunk.resume;
+                if (chunk.result != LexResult::END)
+                    report_lex_error(file, chunk.result, chunk.resume);
+                break;
+            }
+            tokens.push_back(token);
+            /* Never synchronized; carry on against the following chunk */
+            if (start >= limit)
+                break;
+        }
+    }
+
+    /* The last chunk may have been replaced by serial lexing that stopped at its limit */
+    Token token;
+    LexResult result;
+    while ((result = lex_token(cursor, begin, end, token)) == LexResult::TOKEN)
+        tokens.push_back(token);
+    if (result != LexResult::END)
+        report_lex_error(file, result, static_cast<uint32_t>(cursor - begin));
+    return tokens;
+}
@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <utility>
+
+#include <ve/closure.hpp>
+#include <ve/exceptions.hpp>
+#include <ve/shapes.hpp>
+
+namespace {
+    using HSharpParser::ExprKind;
+    using HSharpVE::ClosureOperand;
+    using HSharpVE::ClosureState;
+    using HSharpVE::ExprClosure;
+    using HSharpVE::ExprFunction;
+    using HSharpVE::StmtClosure;
+    using HSharpVE::StmtFunction;
+    using HSharpVE::Value;
+    using HSharpVE::ValueType;
+
+    enum class Shape : std::uint8_t {
+        CONSTANT,
+        GLOBAL,
+        NODE
+    };
+
+    /* Expressions nested deeper than this are swept iteratively, so that evaluating them cannot
+     * overflow the native stack; no hand-written program comes close */
+    constexpr std::uint32_t max_closure_depth = 4096;
+
+    template<Shape shape>
+    [[gnu::always_inline]] inline Value operand(const ClosureOperand& operand, ClosureState& state) {
+        if constexpr (shape == Shape::CONSTANT) {
+            return operand.constant;
+        } else if constexpr (shape == Shape::GLOBAL) {
+            const Value& value = state.globals[operand.symbol];
+            if (value.type == ValueType::UNDEFINED) [[unlikely]]
+                HSharpVE::fail_undefined_identifier();
+            return value;
+        } else {
+            return operand.node->eval(*operand.node, state);
+        }
+    }
+
+    /* An operand already known to be an integer, and for a global, to be declared */
+    template<Shape shape>
+    [[gnu::always_inline]] inline std::int64_t integer_operand(const ClosureOperand& operand, ClosureState& state) {
+        if constexpr (shape == Shape::CONSTANT)
+            return operand.constant.integer;
+        else if constexpr (shape == Shape::GLOBAL)
+            return state.globals[operand.symbol].integer;
+        else
+            return operand.node->eval(*operand.node, state).integer;
+    }
+
+    /* The quickened form, with no type checks */
+    template<ExprKind kind, Shape left, Shape right>
+    Value eval_integer(ExprClosure& self, ClosureState& state) {
+        const std::int64_t l = integer_operand<left>(self.left, state);
+        const std::int64_t r = integer_operand<right>(self.right, state);
+        return Value::make_int(HSharpVE::integer_arithmetic<kind>(l, r));
+    }
+
+    /* The checked form. Having evaluated once, necessarily on integers, it quickens itself.
+     * Globals, once declared, stay declared, so only a change of type can invalidate that. */
+    template<ExprKind kind, Shape left, Shape right>
+    Value eval_binary(ExprClosure& self, ClosureState& state) {
+        const Value l = operand<left>(self.left, state);
+        const Value r = operand<right>(self.right, state);
+        const Value result = HSharpVE::arithmetic<kind>(l, r);
+        self.eval = &eval_integer<kind, left, right>;
+        return result;
+    }
+
+    /* Returns the quickened nodes reading symbol to their checked form */
+    void deoptimize(ClosureState& state, const std::uint32_t symbol) {
+        HSharpVE::ClosureProgram& program = *state.program;
+        if (symbol + 1 >= program.reader_offsets.size())
+            return;
+        bool deoptimized = false;
+        for (std::uint32_t i = program.reader_offsets[symbol]; i < program.reader_offsets[symbol + 1]; i++) {
+            ExprClosure& node = program.expressions[program.readers[i]];
+            deoptimized |= node.eval != node.entry;
+            node.eval = node.entry;
+        }
+        state.deoptimizations += deoptimized;
+    }
+
+    /* Indexed by checked * 9 + left * 3 + right */
+    template<ExprKind kind, std::size_t... index>
+    constexpr std::array<ExprFunction, sizeof...(index)> binary_table(std::index_sequence<index...>) {
+        return {(index >= 9 ? &eval_binary<kind, static_cast<Shape>(index / 3 % 3), static_cast<Shape>(index % 3)>
+                            : &eval_integer<kind, static_cast<Shape>(index / 3 % 3), static_cast<Shape>(index % 3)>)...};
+    }
+
+    template<ExprKind kind>
+    ExprFunction binary_function(const bool checked, const Shape left, const Shape right) {
+        static constexpr auto table = binary_table<kind>(std::make_index_sequence<18>());
+        return table[(checked ? 9 : 0) + static_cast<std::size_t>(left) * 3 + static_cast<std::size_t>(right)];
+    }
+
+    ExprFunction binary_function(const ExprKind kind, const bool checked, const Shape left, const Shape right) {
+        switch (kind) {
+            case ExprKind::ADD: return binary_function<ExprKind::ADD>(checked, left, right);
+            case ExprKind::SUB: return binary_function<ExprKind::SUB>(checked, left, right);
+            case ExprKind::MUL: return binary_function<ExprKind::MUL>(checked, left, right);
+            case ExprKind::DIV: return binary_function<ExprKind::DIV>(checked, left, right);
+            default: std::unreachable();
+        }
+    }
+
+    /* The tree walker's postorder sweep; left holds the first node and right the node count */
+    Value eval_sweep(ExprClosure& self, ClosureState& state) {
+        std::pmr::vector<Value>& stack = state.stack;
+        stack.clear();
+        for (const HSharpParser::ExprNode& node : state.source.expressions.subspan(self.left.symbol, self.right.symbol)) {
+            switch (node.kind) {
+                case ExprKind::INT_LIT: stack.push_back(Value::make_int(node.int_value())); continue;
+                case ExprKind::STR_LIT: stack.push_back(Value::make_string(node.a, node.b)); continue;
+                case ExprKind::IDENT: {
+                    ClosureOperand global;
+                    global.symbol = node.a;
+                    stack.push_back(operand<Shape::GLOBAL>(global, state));
+                    continue;
+                }
+                default: break;
+            }
+            const Value right = stack.back();
+            stack.pop_back();
+            Value& left = stack.back();
+            switch (node.kind) {
+                case ExprKind::ADD: left = HSharpVE::arithmetic<ExprKind::ADD>(left, right); break;
+                case ExprKind::SUB: left = HSharpVE::arithmetic<ExprKind::SUB>(left, right); break;
+                case ExprKind::MUL: left = HSharpVE::arithmetic<ExprKind::MUL>(left, right); break;
+                case ExprKind::DIV: left = HSharpVE::arithmetic<ExprKind::DIV>(left, right); break;
+                default: std::unreachable();
+            }
+        }
+        return stack.back();
+    }
+
+    template<Shape shape>
+    void exec_print(const StmtClosure& self, ClosureState& state) {
+        HSharpVE::print_value(operand<shape>(self.value, state), state.source.string_data);
+    }
+
+    template<Shape shape>
+    void exec_exit(const StmtClosure& self, ClosureState& state) {
+        HSharpVE::exit_with_value(operand<shape>(self.value, state), state.source.string_data);
+    }
+
+    template<Shape shape>
+    void exec_var(const StmtClosure& self, ClosureState& state) {
+        if (state.globals[self.symbol].type != ValueType::UNDEFINED) [[unlikely]]
+            HSharpVE::fail_redeclaration();
+        state.globals[self.symbol] = operand<shape>(self.value, state);
+    }
+
+    template<Shape shape>
+    void exec_assign(const StmtClosure& self, ClosureState& state) {
+        Value& global = state.globals[self.symbol];
+        if (global.type == ValueType::UNDEFINED) [[unlikely]]
+            throwFatalVirtualEnvException("AssignException: cannot assign value to immediate value");
+        const Value value = operand<shape>(self.value, state);
+        if (value.type != global.type) [[unlikely]]
+            deoptimize(state, self.symbol);
+        global = value;
+    }
+
+    /* x = x + <int>; fused into one closure. The global keeps its type, so nothing quickened
+     * on it needs deoptimizing. */
+    void exec_update(const StmtClosure& self, ClosureState& state) {
+        Value& global = state.globals[self.symbol];
+        if (global.type == ValueType::UNDEFINED) [[unlikely]]
+            throwFatalVirtualEnvException("AssignException: cannot assign value to immediate value");
+        global = HSharpVE::arithmetic<ExprKind::ADD>(global, self.value.constant);
+    }
+
+    void exec_input(const StmtClosure&, ClosureState&) {
+        /* The tree walker fails before evaluating the argument too */
+        throwFatalVirtualEnvException("Not implemented: input()");
+    }
+
+    void exec_import(const StmtClosure&, ClosureState&) {
+        throwFatalVirtualEnvException("Unresolved import: program was not linked");
+    }
+
+    StmtFunction statement_function(const HSharpParser::StmtKind kind, const Shape shape) {
+        using HSharpParser::StmtKind;
+        static constexpr StmtFunction print[] = {&exec_print<Shape::CONSTANT>, &exec_print<Shape::GLOBAL>, &exec_print<Shape::NODE>};
+        static constexpr StmtFunction exit[] = {&exec_exit<Shape::CONSTANT>, &exec_exit<Shape::GLOBAL>, &exec_exit<Shape::NODE>};
+        static constexpr StmtFunction var[] = {&exec_var<Shape::CONSTANT>, &exec_var<Shape::GLOBAL>, &exec_var<Shape::NODE>};
+        static constexpr StmtFunction assign[] = {&exec_assign<Shape::CONSTANT>, &exec_assign<Shape::GLOBAL>, &exec_assign<Shape::NODE>};
+        const auto index = static_cast<std::size_t>(shape);
+        switch (kind) {
+            case StmtKind::PRINT: return print[index];
+            case StmtKind::EXIT: return exit[index];
+            case StmtKind::VAR: return var[index];
+            case StmtKind::ASSIGN: return assign[index];
+            default: std::unreachable();
+        }
+    }
+
+    struct Compiled {
+        Shape shape = Shape::CONSTANT;
+        ClosureOperand operand;
+        /* Closure nesting below this operand */
+        std::uint32_t depth = 0;
+        /* Whether the operand is an integer whenever it evaluates at all */
+        bool integer = false;
+    };
+
+    class ClosureCompiler {
+    private:
+        HSharpParser::ProgramView source;
+        HSharpVE::ClosureProgram& out;
+        /* By expression run, first node in the high half and node count in the low one */
+        std::unordered_map<std::uint64_t, Compiled> compiled;
+        std::vector<Compiled> operands;
+        /* Symbol and node index of every checked node reading a global */
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> reads;
+
+        ExprClosure* emit(const ExprFunction eval, const ClosureOperand left, const ClosureOperand right) {
+            out.expressions.push_back({eval, eval, left, right});
+            return &out.expressions.back();
+        }
+
+        Compiled sweep(const HSharpParser::StmtNode& stmt) {
+            ClosureOperand first, count;
+            first.symbol = stmt.first;
+            count.symbol = stmt.count;
+            Compiled result{.shape = Shape::NODE, .integer = true};
+            result.operand.node = emit(&eval_sweep, first, count);
+            out.swept++;
+            return result;
+        }
+
+        Compiled expression(const HSharpParser::StmtNode& stmt) {
+            const std::uint64_t key = static_cast<std::uint64_t>(stmt.first) << 32 | stmt.count;
+            if (const auto found = compiled.find(key); found != compiled.end())
+                return found->second;
+            operands.clear();
+            const std::size_t mark = out.expressions.size();
+            const std::size_t reads_mark = reads.size();
+            for (const HSharpParser::ExprNode& node : source.expressions.subspan(stmt.first, stmt.count)) {
+                Compiled value;
+                switch (node.kind) {
+                    case ExprKind::INT_LIT:
+                        value.operand.constant = Value::make_int(node.int_value());
+                        value.integer = true;
+                        break;
+                    case ExprKind::STR_LIT:
+                        value.operand.constant = Value::make_string(node.a, node.b);
+                        break;
+                    case ExprKind::IDENT:
+                        value.shape = Shape::GLOBAL;
+                        value.operand.symbol = node.a;
+                        break;
+                    default: {
+                        const Compiled right = operands.back();
+                        operands.pop_back();
+                        const Compiled left = operands.back();
+                        operands.pop_back();
+                        value.shape = Shape::NODE;
+                        value.integer = true;
+                        value.depth = std::max(left.depth, right.depth) + 1;
+                        if (value.depth > max_closure_depth) {
+                            /* Nothing points at the closures built so far */
+                            out.expressions.resize(mark);
+                            reads.resize(reads_mark);
+                            return compiled[key] = sweep(stmt);
+                        }
+                        const bool checked = !left.integer || !right.integer;
+                        value.operand.node = emit(binary_function(node.kind, checked, left.shape, right.shape),
+                                                  left.operand, right.operand);
+                        const auto index = static_cast<std::uint32_t>(out.expressions.size() - 1);
+                        if (left.shape == Shape::GLOBAL)
+                            reads.emplace_back(left.operand.symbol, index);
+                        if (right.shape == Shape::GLOBAL
+                            && (left.shape != Shape::GLOBAL || left.operand.symbol != right.operand.symbol))
+                            reads.emplace_back(right.operand.symbol, index);
+                    }
+                }
+                operands.push_back(value);
+            }
+            return compiled[key] = operands.back();
+        }
+
+    public:
+        ClosureCompiler(const HSharpParser::ProgramView source, HSharpVE::ClosureProgram& out) : source(source), out(out) {}
+
+        void compile() {
+            using HSharpParser::StmtKind;
+            for (const HSharpParser::StmtNode& stmt : source.statements) {
+                StmtClosure closure{.symbol = stmt.symbol};
+                /* print(<ident>); and var x = <literal>; are single closures already */
+                if (const HSharpVE::FusedStatement fused = HSharpVE::match_shape(source, stmt);
+                    fused.shape == HSharpVE::StatementShape::UPDATE) {
+                    closure.exec = &exec_update;
+                    closure.value.constant = Value::make_int(fused.addend);
+                    out.statements.push_back(closure);
+                    out.fused++;
+                    continue;
+                }
+                switch (stmt.kind) {
+                    case StmtKind::INPUT: closure.exec = &exec_input; break;
+                    case StmtKind::IMPORT: closure.exec = &exec_import; break;
+                    default: {
+                        const Compiled value = expression(stmt);
+                        closure.exec = statement_function(stmt.kind, value.shape);
+                        closure.value = value.operand;
+                    }
+                }
+                out.statements.push_back(closure);
+            }
+            out.source = source;
+            index_readers();
+        }
+
+        /* Counting sort of reads into the reader lists */
+        void index_readers() {
+            std::uint32_t symbols = 0;
+            for (const auto& [symbol, index] : reads)
+                symbols = std::max(symbols, symbol + 1);
+            out.reader_offsets.assign(symbols + 1, 0);
+            for (const auto& [symbol, index] : reads)
+                out.reader_offsets[symbol + 1]++;
+            for (std::uint32_t symbol = 0; symbol < symbols; symbol++)
+                out.reader_offsets[symbol + 1] += out.reader_offsets[symbol];
+            out.readers.resize(reads.size());
+            std::vector<std::uint32_t> next(out.reader_offsets.begin(), out.reader_offsets.end() - 1);
+            for (const auto& [symbol, index] : reads)
+                out.readers[next[symbol]++] = index;
+        }
+    };
+}
+
+HSharpVE::ClosureProgram HSharpVE::compile_closures(const HSharpParser::ProgramView program,
+                                                    std::pmr::memory_resource* resource) {
+    ClosureProgram out(resource);
+    /* An upper bound: at most one closure per operator, plus a sweep per statement */
+    out.expressions.reserve(program.expressions.size() + program.statements.size());
+    out.statements.reserve(program.statements.size());
+    ClosureCompiler(program, out).compile();
+    return out;
+}
+
+void HSharpVE::ClosureEngine::run() {
+    globals.assign(symbols.size(), Value{});
+    for (ExprClosure& expression : program.expressions)
+        expression.eval = expression.entry;
+    state.program = &program;
+    state.deoptimizations = 0;
+    state.globals = globals.data();
+    state.source = program.source;
+    for (const StmtClosure& statement : program.statements)
+        statement.exec(statement, state);
+}
+
+std::size_t HSharpVE::ClosureEngine::quickened_count() const {
+    return std::ranges::count_if(program.expressions,
+                                 [](const ExprClosure& expression) { return expression.eval != expression.entry; });
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include <ve/bytecode.hpp>
+#include <ve/exceptions.hpp>
+#include <ve/shapes.hpp>
+
+namespace {
+    /* Registers are numbered from 0 while compiling and moved behind the constant pool once
+     * its size is known; this bit tells them apart until then */
+    constexpr std::uint32_t register_flag = 0x80000000u;
+
+    HSharpVE::Opcode arithmetic_opcode(const HSharpParser::ExprKind kind) {
+        switch (kind) {
+            case HSharpParser::ExprKind::ADD: return HSharpVE::Opcode::ADD;
+            case HSharpParser::ExprKind::SUB: return HSharpVE::Opcode::SUB;
+            case HSharpParser::ExprKind::MUL: return HSharpVE::Opcode::MUL;
+            case HSharpParser::ExprKind::DIV: return HSharpVE::Opcode::DIV;
+            default: std::unreachable();
+        }
+    }
+
+    class Compiler {
+    private:
+        HSharpParser::ProgramView source;
+        HSharpVE::BytecodeProgram& out;
+        std::unordered_map<std::int64_t, std::uint32_t> integers;
+        std::unordered_map<std::string_view, std::uint32_t> strings;
+        /* Slot of every value on the expression stack */
+        std::vector<std::uint32_t> operands;
+
+        std::uint32_t constant(const HSharpVE::Value value) {
+            out.constants.push_back(value);
+            return static_cast<std::uint32_t>(out.constants.size() - 1);
+        }
+
+        std::uint32_t push_register() {
+            const auto reg = static_cast<std::uint32_t>(operands.size());
+            out.register_count = std::max(out.register_count, reg + 1);
+            operands.push_back(reg | register_flag);
+            return reg | register_flag;
+        }
+
+        void emit(const HSharpVE::Opcode op, const std::uint32_t a = 0, const std::uint32_t b = 0, const std::uint32_t c = 0) {
+            out.code.push_back({op, a, b, c});
+        }
+
+        std::uint32_t integer_constant(const std::int64_t value) {
+            const auto [entry, inserted] = integers.try_emplace(value, 0);
+            if (inserted)
+                entry->second = constant(HSharpVE::Value::make_int(value));
+            return entry->second;
+        }
+
+        std::uint32_t string_constant(const HSharpParser::ExprNode& node) {
+            const auto [entry, inserted] = strings.try_emplace(source.string(node), 0);
+            if (inserted)
+                entry->second = constant(HSharpVE::Value::make_string(node.a, node.b));
+            return entry->second;
+        }
+
+        /* Emits stmt as one superinstruction if it has a fused shape */
+        bool fuse(const HSharpParser::StmtNode& stmt) {
+            using HSharpVE::StatementShape;
+            const HSharpVE::FusedStatement fused = HSharpVE::match_shape(source, stmt);
+            switch (fused.shape) {
+                case StatementShape::UPDATE:
+                    emit(HSharpVE::Opcode::ADD_GLOBAL, stmt.symbol, integer_constant(fused.addend));
+                    break;
+                case StatementShape::PRINT_GLOBAL:
+                    emit(HSharpVE::Opcode::PRINT_GLOBAL, fused.operand->a);
+                    break;
+                case StatementShape::DECLARE_CONSTANT:
+                    emit(HSharpVE::Opcode::DECLARE, stmt.symbol,
+                         fused.operand->kind == HSharpParser::ExprKind::INT_LIT ? integer_constant(fused.operand->int_value())
+                                                                                : string_constant(*fused.operand));
+                    break;
+                case StatementShape::GENERIC:
+                    return false;
+            }
+            out.fused++;
+            return true;
+        }
+
+        /* Leaves the expression's value in operands.back() */
+        void expression(const HSharpParser::StmtNode& stmt) {
+            using HSharpParser::ExprKind;
+            operands.clear();
+            for (const HSharpParser::ExprNode& node : source.expressions.subspan(stmt.first, stmt.count)) {
+                switch (node.kind) {
+                    case ExprKind::INT_LIT:
+                        operands.push_back(integer_constant(node.int_value()));
+                        break;
+                    case ExprKind::STR_LIT:
+                        operands.push_back(string_constant(node));
+                        break;
+                    case ExprKind::IDENT: {
+                        const std::uint32_t reg = push_register();
+                        emit(HSharpVE::Opcode::LOAD_GLOBAL, reg, node.a);
+                        break;
+                    }
+                    default: {
+                        const std::uint32_t right = operands.back();
+                        operands.pop_back();
+                        const std::uint32_t left = operands.back();
+                        operands.pop_back();
+                        const std::uint32_t reg = push_register();
+                        emit(arithmetic_opcode(node.kind), reg, left, right);
+                    }
+                }
+            }
+        }
+
+        void relocate() {
+            const auto base = static_cast<std::uint32_t>(out.constants.size());
+            const auto slot = [base](std::uint32_t& operand) {
+                if (operand & register_flag)
+                    operand = base + (operand & ~register_flag);
+            };
+            for (HSharpVE::Instruction& instruction : out.code) {
+                switch (instruction.op) {
+                    case HSharpVE::Opcode::LOAD_GLOBAL:
+                    case HSharpVE::Opcode::PRINT:
+                    case HSharpVE::Opcode::EXIT:
+                        slot(instruction.a);
+                        break;
+                    case HSharpVE::Opcode::ADD:
+                    case HSharpVE::Opcode::SUB:
+                    case HSharpVE::Opcode::MUL:
+                    case HSharpVE::Opcode::DIV:
+                        slot(instruction.a);
+                        slot(instruction.b);
+                        slot(instruction.c);
+                        break;
+                    case HSharpVE::Opcode::STORE_GLOBAL:
+                        slot(instruction.b);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+    public:
+        Compiler(const HSharpParser::ProgramView source, HSharpVE::BytecodeProgram& out) : source(source), out(out) {}
+
+        void compile() {
+            using HSharpParser::StmtKind;
+            using HSharpVE::Opcode;
+            for (const HSharpParser::StmtNode& stmt : source.statements) {
+                if (fuse(stmt))
+                    continue;
+                switch (stmt.kind) {
+                    case StmtKind::EXIT:
+                        expression(stmt);
+                        emit(Opcode::EXIT, operands.back());
+                        break;
+                    case StmtKind::PRINT:
+                        expression(stmt);
+                        emit(Opcode::PRINT, operands.back());
+                        break;
+                    case StmtKind::INPUT:
+                        /* The tree walker fails before evaluating the argument too */
+                        emit(Opcode::INPUT);
+                        break;
+                    case StmtKind::VAR:
+                        emit(Opcode::CHECK_UNDECLARED, stmt.symbol);
+                        expression(stmt);
+                        emit(Opcode::STORE_GLOBAL, stmt.symbol, operands.back());
+                        break;
+                    case StmtKind::ASSIGN:
+                        emit(Opcode::CHECK_DECLARED, stmt.symbol);
+                        expression(stmt);
+                        emit(Opcode::STORE_GLOBAL, stmt.symbol, operands.back());
+                        break;
+                    case StmtKind::IMPORT:
+                        throwFatalVirtualEnvException("Unresolved import: program was not linked");
+                }
+            }
+            emit(Opcode::HALT);
+            relocate();
+            out.string_data = source.string_data;
+        }
+    };
+}
+
+HSharpVE::BytecodeProgram HSharpVE::compile(const HSharpParser::ProgramView program, std::pmr::memory_resource* resource) {
+    BytecodeProgram out(resource);
+    out.code.reserve(program.expressions.size() + program.statements.size() * 2 + 1);
+    Compiler(program, out).compile();
+    return out;
+}
@@ -0,0 +1,663 @@
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <ve/jit.hpp>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HSHARP_JIT_X86 1
+#endif
+
+namespace {
+    struct JitContext {
+        std::string_view string_data;
+    };
+
+    using Entry = std::uint32_t (*)(HSharpVE::Value* slots, HSharpVE::Value* globals, const JitContext* context);
+
+#ifdef HSHARP_JIT_X86
+    using HSharpVE::Opcode;
+    using HSharpVE::Value;
+    using HSharpVE::ValueType;
+
+    /* The templates poke at Values directly */
+    static_assert(offsetof(Value, type) == 0 && offsetof(Value, integer) == 8);
+    static_assert(static_cast<std::uint8_t>(ValueType::UNDEFINED) == 0 && static_cast<std::uint8_t>(ValueType::INT) == 1);
+
+    void print_helper(const Value* value, const JitContext* context) {
+        HSharpVE::print_value(*value, context->string_data);
+    }
+
+    [[noreturn]] void exit_helper(const Value* value, const JitContext* context) {
+        HSharpVE::exit_with_value(*value, context->string_data);
+    }
+
+    enum Register : std::uint8_t {
+        RAX = 0,
+        RCX = 1,
+        RDX = 2,
+        RBX = 3,
+        RSI = 6,
+        RDI = 7,
+        R8 = 8,
+        R9 = 9,
+        R10 = 10,
+        R11 = 11,
+        R14 = 14,
+        R15 = 15
+    };
+
+    /* Callee-saved, so they survive the helper calls */
+    constexpr Register slots_base = RBX;
+    constexpr Register globals_base = R14;
+    constexpr Register context_register = R15;
+
+    /* Expression values at the first few stack depths live in these; rax, rcx and rdx are
+     * left as scratch, and idiv needs the latter */
+    constexpr Register depth_registers[] = {R8, R9, R10, R11, RSI, RDI};
+
+    enum class Operation : std::uint8_t {
+        ADD,
+        SUB,
+        MUL
+    };
+
+    enum class Condition : std::uint8_t {
+        EQUAL = 0x84,
+        NOT_EQUAL = 0x85
+    };
+
+    /* Just the x86-64 encodings the templates use. Memory operands are all [base + disp32],
+     * and none of the bases needs a SIB byte. */
+    class Assembler {
+    private:
+        std::vector<std::uint8_t> code;
+
+        void rex(const bool wide, const unsigned reg, const unsigned rm) {
+            const auto prefix = static_cast<std::uint8_t>(0x40 | (wide ? 8 : 0) | (reg >> 3) << 2 | rm >> 3);
+            if (prefix != 0x40)
+                byte(prefix);
+        }
+        void memory(const unsigned reg, const unsigned base, const std::int32_t disp) {
+            byte(static_cast<std::uint8_t>(0x80 | (reg & 7) << 3 | (base & 7)));
+            dword(static_cast<std::uint32_t>(disp));
+        }
+        void direct(const unsigned reg, const unsigned rm) {
+            byte(static_cast<std::uint8_t>(0xC0 | (reg & 7) << 3 | (rm & 7)));
+        }
+        /* The reg, r/m forms */
+        void opcode(const Operation operation) {
+            switch (operation) {
+                case Operation::ADD: byte(0x03); break;
+                case Operation::SUB: byte(0x2B); break;
+                case Operation::MUL: byte(0x0F); byte(0xAF); break;
+            }
+        }
+
+    public:
+        [[nodiscard]] std::size_t position() const { return code.size(); }
+        [[nodiscard]] std::vector<std::uint8_t>& bytes() { return code; }
+
+        void byte(const std::uint8_t value) { code.push_back(value); }
+        void dword(const std::uint32_t value) {
+            for (int shift = 0; shift < 32; shift += 8)
+                byte(static_cast<std::uint8_t>(value >> shift));
+        }
+        void qword(const std::uint64_t value) {
+            dword(static_cast<std::uint32_t>(value));
+            dword(static_cast<std::uint32_t>(value >> 32));
+        }
+
+        /* mov reg, [base + disp] */
+        void load(const Register reg, const Register base, const std::int32_t disp) {
+            rex(true, reg, base);
+            byte(0x8B);
+            memory(reg, base, disp);
+        }
+        /* mov [base + disp], reg */
+        void store(const Register base, const std::int32_t disp, const Register reg) {
+            rex(true, reg, base);
+            byte(0x89);
+            memory(reg, base, disp);
+        }
+        /* mov byte [base + disp], value */
+        void store_byte(const Register base, const std::int32_t disp, const std::uint8_t value) {
+            rex(false, 0, base);
+            byte(0xC6);
+            memory(0, base, disp);
+            byte(value);
+        }
+        void lea(const Register reg, const Register base, const std::int32_t disp) {
+            rex(true, reg, base);
+            byte(0x8D);
+            memory(reg, base, disp);
+        }
+        void move(const Register to, const Register from) {
+            rex(true, from, to);
+            byte(0x89);
+            direct(from, to);
+        }
+        void move_immediate(const Register reg, const std::uint64_t value) {
+            rex(true, 0, reg);
+            byte(static_cast<std::uint8_t>(0xB8 | (reg & 7)));
+            qword(value);
+        }
+        /* mov r32, value, which zero-extends */
+        void move_immediate32(const Register reg, const std::uint32_t value) {
+            rex(false, 0, reg);
+            byte(static_cast<std::uint8_t>(0xB8 | (reg & 7)));
+            dword(value);
+        }
+
+        /* reg op= [base + disp] */
+        void operate(const Operation operation, const Register reg, const Register base, const std::int32_t disp) {
+            rex(true, reg, base);
+            opcode(operation);
+            memory(reg, base, disp);
+        }
+        /* reg op= source */
+        void operate(const Operation operation, const Register reg, const Register source) {
+            rex(true, reg, source);
+            opcode(operation);
+            direct(reg, source);
+        }
+        /* reg op= value */
+        void operate(const Operation operation, const Register reg, const std::int32_t value) {
+            if (operation == Operation::MUL) {
+                rex(true, reg, reg);
+                byte(0x69);
+                direct(reg, reg);
+            } else {
+                rex(true, 0, reg);
+                byte(0x81);
+                direct(operation == Operation::ADD ? 0 : 5, reg);
+            }
+            dword(static_cast<std::uint32_t>(value));
+        }
+        /* add qword [base + disp], value */
+        void add_to_memory(const Register base, const std::int32_t disp, const std::int32_t value) {
+            rex(true, 0, base);
+            byte(0x81);
+            memory(0, base, disp);
+            dword(static_cast<std::uint32_t>(value));
+        }
+        /* add [base + disp], reg */
+        void add_to_memory(const Register base, const std::int32_t disp, const Register reg) {
+            rex(true, reg, base);
+            byte(0x01);
+            memory(reg, base, disp);
+        }
+        /* cqo; idiv divisor */
+        void divide(const Register divisor) {
+            byte(0x48);
+            byte(0x99);
+            rex(true, 0, divisor);
+            byte(0xF7);
+            direct(7, divisor);
+        }
+        void negate(const Register reg) {
+            rex(true, 0, reg);
+            byte(0xF7);
+            direct(3, reg);
+        }
+        void test(const Register reg) {
+            rex(true, reg, reg);
+            byte(0x85);
+            direct(reg, reg);
+        }
+        void compare_immediate(const Register reg, const std::int8_t value) {
+            rex(true, 0, reg);
+            byte(0x83);
+            direct(7, reg);
+            byte(static_cast<std::uint8_t>(value));
+        }
+
+        void call(const Register reg) {
+            rex(false, 0, reg);
+            byte(0xFF);
+            direct(2, reg);
+        }
+        void push(const Register reg) {
+            rex(false, 0, reg);
+            byte(static_cast<std::uint8_t>(0x50 | (reg & 7)));
+        }
+        void pop(const Register reg) {
+            rex(false, 0, reg);
+            byte(static_cast<std::uint8_t>(0x58 | (reg & 7)));
+        }
+        void ret() { byte(0xC3); }
+        void trap() {
+            byte(0x0F);
+            byte(0x0B);
+        }
+
+        /* Both return where their rel32 is, for patch() */
+        std::size_t jump() {
+            byte(0xE9);
+            dword(0);
+            return position() - 4;
+        }
+        std::size_t jump_if(const Condition condition) {
+            byte(0x0F);
+            byte(static_cast<std::uint8_t>(condition));
+            dword(0);
+            return position() - 4;
+        }
+        void patch(const std::size_t at, const std::size_t target) {
+            const auto relative = static_cast<std::uint32_t>(static_cast<std::int64_t>(target) - static_cast<std::int64_t>(at + 4));
+            for (std::size_t i = 0; i < 4; i++)
+                code[at + i] = static_cast<std::uint8_t>(relative >> (8 * i));
+        }
+    };
+
+    /* Keeps every displacement within a signed 32 bits */
+    constexpr std::size_t max_values = std::size_t{1} << 27;
+
+    /* Where the current value of a slot is */
+    enum class Location : std::uint8_t {
+        MEMORY,
+        /* In its depth register */
+        MACHINE,
+        /* Still in the global it was loaded from; expressions never write globals */
+        ALIAS
+    };
+
+    class JitCompiler {
+    private:
+        const HSharpVE::BytecodeProgram& program;
+        Assembler assembler;
+        /* The type each slot and global holds at the instruction being compiled. Globals are
+         * always written through, so theirs are also the type bytes in memory; slot_memory is
+         * what the slots' type bytes say, which lags while a value lives elsewhere. */
+        std::vector<ValueType> slot_types;
+        std::vector<ValueType> slot_memory;
+        std::vector<ValueType> global_types;
+        std::vector<Location> locations;
+        /* The global an ALIAS slot reads */
+        std::vector<std::uint32_t> aliases;
+        /* Slots not in MEMORY; a statement's registers are dead once it has consumed them */
+        std::vector<std::uint32_t> live;
+        /* Conditional jumps to a bail-out stub, with the instruction to resume at */
+        std::vector<std::pair<std::size_t, std::uint32_t>> bailouts;
+        /* Jumps to the epilogue */
+        std::vector<std::size_t> exits;
+
+        static std::int32_t type_of(const std::uint32_t index) { return static_cast<std::int32_t>(index * sizeof(Value)); }
+        static std::int32_t integer_of(const std::uint32_t index) { return type_of(index) + 8; }
+
+        [[nodiscard]] bool is_constant(const std::uint32_t slot) const { return slot < program.constants.size(); }
+        /* A constant integer operand that fits an imm32 */
+        [[nodiscard]] bool is_immediate(const std::uint32_t slot) const {
+            if (!is_constant(slot))
+                return false;
+            const std::int64_t value = program.constants[slot].integer;
+            return value >= INT32_MIN && value <= INT32_MAX;
+        }
+        [[nodiscard]] std::int32_t immediate(const std::uint32_t slot) const {
+            return static_cast<std::int32_t>(program.constants[slot].integer);
+        }
+        /* Only the shallowest registers get a machine register */
+        [[nodiscard]] bool has_register(const std::uint32_t slot) const {
+            return !is_constant(slot) && slot - program.constants.size() < std::size(depth_registers);
+        }
+        [[nodiscard]] Register register_of(const std::uint32_t slot) const {
+            return depth_registers[slot - program.constants.size()];
+        }
+
+        void copy(const Register to_base, const std::uint32_t to, const Register from_base, const std::uint32_t from) {
+            assembler.load(RAX, from_base, type_of(from));
+            assembler.load(RCX, from_base, integer_of(from));
+            assembler.store(to_base, type_of(to), RAX);
+            assembler.store(to_base, integer_of(to), RCX);
+        }
+
+        /* Slot a = reg, an integer */
+        void store_integer(const std::uint32_t a, const Register reg) {
+            assembler.store(slots_base, integer_of(a), reg);
+            if (slot_memory[a] != ValueType::INT)
+                assembler.store_byte(slots_base, type_of(a), static_cast<std::uint8_t>(ValueType::INT));
+            slot_memory[a] = ValueType::INT;
+        }
+
+        /* Writes slot back to memory */
+        void flush(const std::uint32_t slot) {
+            if (locations[slot] == Location::MACHINE) {
+                store_integer(slot, register_of(slot));
+            } else if (locations[slot] == Location::ALIAS) {
+                if (slot_types[slot] == ValueType::INT) {
+                    assembler.load(RAX, globals_base, integer_of(aliases[slot]));
+                    store_integer(slot, RAX);
+                } else {
+                    copy(slots_base, slot, globals_base, aliases[slot]);
+                    slot_memory[slot] = slot_types[slot];
+                }
+            }
+            locations[slot] = Location::MEMORY;
+        }
+        void flush_all() {
+            for (const std::uint32_t slot : live)
+                flush(slot);
+            live.clear();
+        }
+        /* Ends a statement; its registers are never read again */
+        void retire() {
+            for (const std::uint32_t slot : live)
+                locations[slot] = Location::MEMORY;
+            live.clear();
+        }
+        void set_location(const std::uint32_t slot, const Location location) {
+            if (locations[slot] == Location::MEMORY)
+                live.push_back(slot);
+            locations[slot] = location;
+        }
+
+        /* reg = the integer in slot */
+        void load_integer(const Register reg, const std::uint32_t slot) {
+            switch (locations[slot]) {
+                case Location::MACHINE:
+                    if (register_of(slot) != reg)
+                        assembler.move(reg, register_of(slot));
+                    break;
+                case Location::ALIAS:
+                    assembler.load(reg, globals_base, integer_of(aliases[slot]));
+                    break;
+                case Location::MEMORY:
+                    assembler.load(reg, slots_base, integer_of(slot));
+                    break;
+            }
+        }
+        /* reg op= the integer in slot */
+        void operate(const Operation operation, const Register reg, const std::uint32_t slot) {
+            if (is_immediate(slot)) {
+                assembler.operate(operation, reg, immediate(slot));
+                return;
+            }
+            switch (locations[slot]) {
+                case Location::MACHINE:
+                    assembler.operate(operation, reg, register_of(slot));
+                    break;
+                case Location::ALIAS:
+                    assembler.operate(operation, reg, globals_base, integer_of(aliases[slot]));
+                    break;
+                case Location::MEMORY:
+                    assembler.operate(operation, reg, slots_base, integer_of(slot));
+                    break;
+            }
+        }
+        /* Slot a = reg, an integer, kept in a's register when it has one */
+        void define(const std::uint32_t a, const Register reg) {
+            slot_types[a] = ValueType::INT;
+            if (!has_register(a)) {
+                if (locations[a] != Location::MEMORY)
+                    std::erase(live, a);
+                locations[a] = Location::MEMORY;
+                store_integer(a, reg);
+                return;
+            }
+            if (register_of(a) != reg)
+                assembler.move(register_of(a), reg);
+            set_location(a, Location::MACHINE);
+        }
+
+        /* The helpers clobber every depth register, but their argument is a statement's last use */
+        void call(void (*helper)(const Value*, const JitContext*), const std::uint32_t slot) {
+            if (locations[slot] == Location::ALIAS) {
+                assembler.lea(RDI, globals_base, type_of(aliases[slot]));
+            } else {
+                flush(slot);
+                assembler.lea(RDI, slots_base, type_of(slot));
+            }
+            retire();
+            assembler.move(RSI, context_register);
+            assembler.move_immediate(RAX, reinterpret_cast<std::uintptr_t>(helper));
+            assembler.call(RAX);
+        }
+
+        /* Returns to the interpreter at pc */
+        void leave(const std::uint32_t pc) {
+            flush_all();
+            assembler.move_immediate32(RAX, pc);
+            exits.push_back(assembler.jump());
+        }
+
+        void bail_if(const Condition condition, const std::uint32_t pc) {
+            bailouts.emplace_back(assembler.jump_if(condition), pc);
+        }
+
+        /* False once the code always leaves at pc, which makes the rest unreachable */
+        bool instruction(const HSharpVE::Instruction& current, const std::uint32_t pc) {
+            const auto [op, a, b, c] = current;
+            switch (op) {
+                case Opcode::LOAD_GLOBAL:
+                    if (global_types[b] == ValueType::UNDEFINED)
+                        break;
+                    slot_types[a] = global_types[b];
+                    aliases[a] = b;
+                    set_location(a, Location::ALIAS);
+                    return true;
+                case Opcode::ADD:
+                case Opcode::SUB:
+                case Opcode::MUL: {
+                    if (slot_types[b] != ValueType::INT || slot_types[c] != ValueType::INT)
+                        break;
+                    const Operation operation = op == Opcode::ADD ? Operation::ADD
+                                              : op == Opcode::SUB ? Operation::SUB
+                                                                  : Operation::MUL;
+                    /* Works in a's register, unless loading b there would overwrite c */
+                    Register work = has_register(a) ? register_of(a) : RAX;
+                    if (b != c && locations[c] == Location::MACHINE && register_of(c) == work)
+                        work = RAX;
+                    load_integer(work, b);
+                    operate(operation, work, c);
+                    define(a, work);
+                    return true;
+                }
+                case Opcode::DIV:
+                    if (slot_types[b] != ValueType::INT || slot_types[c] != ValueType::INT)
+                        break;
+                    /* idiv faults on a zero divisor, which is the interpreter's error to raise, and
+                     * on INT64_MIN / -1, which integer_arithmetic defines as a negation instead */
+                    if (is_constant(c)) {
+                        const std::int64_t divisor = program.constants[c].integer;
+                        if (divisor == 0)
+                            break;
+                        load_integer(RAX, b);
+                        if (divisor == -1) {
+                            assembler.negate(RAX);
+                        } else {
+                            assembler.load(RCX, slots_base, integer_of(c));
+                            assembler.divide(RCX);
+                        }
+                    } else {
+                        /* The guard bails out with everything in memory */
+                        flush_all();
+                        assembler.load(RCX, slots_base, integer_of(c));
+                        assembler.test(RCX);
+                        bail_if(Condition::EQUAL, pc);
+                        assembler.load(RAX, slots_base, integer_of(b));
+                        assembler.compare_immediate(RCX, -1);
+                        const std::size_t to_divide = assembler.jump_if(Condition::NOT_EQUAL);
+                        assembler.negate(RAX);
+                        const std::size_t to_done = assembler.jump();
+                        assembler.patch(to_divide, assembler.position());
+                        assembler.divide(RCX);
+                        assembler.patch(to_done, assembler.position());
+                    }
+                    define(a, RAX);
+                    return true;
+                case Opcode::CHECK_UNDECLARED:
+                    if (global_types[a] != ValueType::UNDEFINED)
+                        break;
+                    return true;
+                case Opcode::CHECK_DECLARED:
+                    if (global_types[a] == ValueType::UNDEFINED)
+                        break;
+                    return true;
+                case Opcode::STORE_GLOBAL:
+                    if (slot_types[b] == ValueType::INT) {
+                        load_integer(RAX, b);
+                        assembler.store(globals_base, integer_of(a), RAX);
+                        if (global_types[a] != ValueType::INT)
+                            assembler.store_byte(globals_base, type_of(a), static_cast<std::uint8_t>(ValueType::INT));
+                    } else if (locations[b] == Location::ALIAS) {
+                        copy(globals_base, a, globals_base, aliases[b]);
+                    } else {
+                        copy(globals_base, a, slots_base, b);
+                    }
+                    global_types[a] = slot_types[b];
+                    retire();
+                    return true;
+                case Opcode::PRINT:
+                    call(&print_helper, a);
+                    return true;
+                case Opcode::EXIT:
+                    call(&exit_helper, a);
+                    assembler.trap();
+                    return false;
+                case Opcode::INPUT:
+                    break;
+                case Opcode::ADD_GLOBAL:
+                    if (global_types[a] != ValueType::INT || slot_types[b] != ValueType::INT)
+                        break;
+                    if (is_immediate(b)) {
+                        assembler.add_to_memory(globals_base, integer_of(a), immediate(b));
+                    } else {
+                        assembler.load(RAX, slots_base, integer_of(b));
+                        assembler.add_to_memory(globals_base, integer_of(a), RAX);
+                    }
+                    return true;
+                case Opcode::PRINT_GLOBAL:
+                    if (global_types[a] == ValueType::UNDEFINED)
+                        break;
+                    assembler.lea(RDI, globals_base, type_of(a));
+                    assembler.move(RSI, context_register);
+                    assembler.move_immediate(RAX, reinterpret_cast<std::uintptr_t>(&print_helper));
+                    assembler.call(RAX);
+                    return true;
+                case Opcode::DECLARE:
+                    if (global_types[a] != ValueType::UNDEFINED)
+                        break;
+                    copy(globals_base, a, slots_base, b);
+                    global_types[a] = slot_types[b];
+                    return true;
+                case Opcode::HALT:
+                    break;
+            }
+            leave(pc);
+            return false;
+        }
+
+    public:
+        JitCompiler(const HSharpVE::BytecodeProgram& program, const std::size_t global_count)
+            : program(program),
+              slot_types(program.constants.size() + program.register_count, ValueType::UNDEFINED),
+              global_types(global_count, ValueType::UNDEFINED),
+              locations(slot_types.size(), Location::MEMORY),
+              aliases(slot_types.size()) {
+            for (std::size_t i = 0; i < program.constants.size(); i++)
+                slot_types[i] = program.constants[i].type;
+            slot_memory = slot_types;
+        }
+
+        /* Returns the machine code and how many instructions it covers */
+        std::pair<std::vector<std::uint8_t>, std::size_t> compile() {
+            /* Three pushes after the return address leave the stack 16-byte aligned for calls */
+            assembler.push(RBX);
+            assembler.push(R14);
+            assembler.push(R15);
+            assembler.move(slots_base, RDI);
+            assembler.move(globals_base, RSI);
+            assembler.move(context_register, RDX);
+
+            /* The program ends in HALT, which always leaves */
+            std::uint32_t pc = 0;
+            while (instruction(program.code[pc], pc))
+                pc++;
+
+            /* One stub per instruction; a DIV has two jumps to its own */
+            std::size_t stub = 0;
+            for (std::size_t i = 0; i < bailouts.size(); i++) {
+                if (i == 0 || bailouts[i].second != bailouts[i - 1].second) {
+                    stub = assembler.position();
+                    leave(bailouts[i].second);
+                }
+                assembler.patch(bailouts[i].first, stub);
+            }
+
+            const std::size_t epilogue = assembler.position();
+            for (const std::size_t exit : exits)
+                assembler.patch(exit, epilogue);
+            assembler.pop(R15);
+            assembler.pop(R14);
+            assembler.pop(RBX);
+            assembler.ret();
+            return {std::move(assembler.bytes()), pc};
+        }
+    };
+#endif
+}
+
+HSharpVE::JitCode::JitCode(JitCode&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)),
+      mapping_size(std::exchange(other.mapping_size, 0)),
+      code_size(std::exchange(other.code_size, 0)),
+      compiled(std::exchange(other.compiled, 0)) {}
+
+HSharpVE::JitCode& HSharpVE::JitCode::operator=(JitCode&& other) noexcept {
+    if (this != &other) {
+#ifdef HSHARP_JIT_X86
+        if (mapping)
+            munmap(mapping, mapping_size);
+#endif
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+        code_size = std::exchange(other.code_size, 0);
+        compiled = std::exchange(other.compiled, 0);
+    }
+    return *this;
+}
+
+HSharpVE::JitCode::~JitCode() {
+#ifdef HSHARP_JIT_X86
+    if (mapping)
+        munmap(mapping, mapping_size);
+#endif
+}
+
+std::optional<HSharpVE::JitCode> HSharpVE::JitCode::compile(const BytecodeProgram& program, const std::size_t global_count) {
+#ifdef HSHARP_JIT_X86
+    if (program.constants.size() + program.register_count >= max_values || global_count >= max_values)
+        return {};
+    auto [code, compiled] = JitCompiler(program, global_count).compile();
+
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t size = (code.size() + page - 1) / page * page;
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return {};
+    std::memcpy(mapping, code.data(), code.size());
+    if (mprotect(mapping, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mapping, size);
+        return {};
+    }
+    JitCode jit;
+    jit.mapping = mapping;
+    jit.mapping_size = size;
+    jit.code_size = code.size();
+    jit.compiled = compiled;
+    return jit;
+#else
+    (void)program;
+    (void)global_count;
+    return {};
+#endif
+}
+
+std::uint32_t HSharpVE::JitCode::run(Value* slots, Value* globals, const std::string_view string_data) const {
+    const JitContext context{string_data};
+    return reinterpret_cast<Entry>(mapping)(slots, globals, &context);
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <ve/shapes.hpp>
+
+namespace {
+    std::string_view shape_name(const HSharpParser::ExprNode& node, const HSharpParser::StmtNode& stmt) {
+        using HSharpParser::ExprKind;
+        using HSharpParser::StmtKind;
+        switch (node.kind) {
+            case ExprKind::INT_LIT: return "int";
+            case ExprKind::STR_LIT: return "str";
+            case ExprKind::IDENT:
+                if ((stmt.kind == StmtKind::VAR || stmt.kind == StmtKind::ASSIGN) && node.a == stmt.symbol)
+                    return "target";
+                return "ident";
+            case ExprKind::ADD: return "add";
+            case ExprKind::SUB: return "sub";
+            case ExprKind::MUL: return "mul";
+            case ExprKind::DIV: return "div";
+        }
+        std::unreachable();
+    }
+
+    std::string_view shape_name(const HSharpParser::StmtKind kind) {
+        using HSharpParser::StmtKind;
+        switch (kind) {
+            case StmtKind::EXIT: return "exit";
+            case StmtKind::PRINT: return "print";
+            case StmtKind::INPUT: return "input";
+            case StmtKind::VAR: return "var";
+            case StmtKind::ASSIGN: return "assign";
+            case StmtKind::IMPORT: return "import";
+        }
+        std::unreachable();
+    }
+}
+
+HSharpVE::FusedStatement HSharpVE::match_shape(const HSharpParser::ProgramView program,
+                                               const HSharpParser::StmtNode& stmt) {
+    using HSharpParser::ExprKind;
+    using HSharpParser::StmtKind;
+    const std::span<const HSharpParser::ExprNode> nodes = program.expressions.subspan(stmt.first, stmt.count);
+    FusedStatement fused;
+    switch (stmt.kind) {
+        case StmtKind::ASSIGN:
+            if (nodes.size() == 3 && nodes[0].kind == ExprKind::IDENT && nodes[0].a == stmt.symbol
+                && nodes[1].kind == ExprKind::INT_LIT && (nodes[2].kind == ExprKind::ADD || nodes[2].kind == ExprKind::SUB)) {
+                const auto addend = static_cast<std::uint64_t>(nodes[1].int_value());
+                fused.shape = StatementShape::UPDATE;
+                fused.addend = static_cast<std::int64_t>(nodes[2].kind == ExprKind::ADD ? addend : 0 - addend);
+            }
+            break;
+        case StmtKind::PRINT:
+            if (nodes.size() == 1 && nodes[0].kind == ExprKind::IDENT) {
+                fused.shape = StatementShape::PRINT_GLOBAL;
+                fused.operand = &nodes[0];
+            }
+            break;
+        case StmtKind::VAR:
+            if (nodes.size() == 1 && (nodes[0].kind == ExprKind::INT_LIT || nodes[0].kind == ExprKind::STR_LIT)) {
+                fused.shape = StatementShape::DECLARE_CONSTANT;
+                fused.operand = &nodes[0];
+            }
+            break;
+        default:
+            break;
+    }
+    return fused;
+}
+
+void HSharpVE::ShapeProfile::add(const HSharpParser::ProgramView program) {
+    std::vector<std::string_view> sequence;
+    for (const HSharpParser::StmtNode& stmt : program.statements) {
+        sequence.clear();
+        for (const HSharpParser::ExprNode& node : program.expressions.subspan(stmt.first, stmt.count))
+            sequence.push_back(shape_name(node, stmt));
+        sequence.push_back(shape_name(stmt.kind));
+        for (std::size_t start = 0; start < sequence.size(); start++) {
+            std::string gram;
+            for (std::size_t n = 1; n <= max_gram && start + n <= sequence.size(); n++) {
+                if (n > 1)
+                    gram += ' ';
+                gram += sequence[start + n - 1];
+                grams[n - 1][gram]++;
+            }
+        }
+        statements++;
+    }
+}
+
+void HSharpVE::ShapeProfile::report(std::FILE* out, const std::size_t top) const {
+    std::fprintf(out, "[VE] shape profile of %zu statements\n", statements);
+    for (std::size_t n = 1; n <= max_gram; n++) {
+        std::vector<std::pair<std::string_view, std::size_t>> ranked(grams[n - 1].begin(), grams[n - 1].end());
+        const std::size_t shown = std::min(top, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(shown), ranked.end(),
+                          [](const auto& left, const auto& right) {
+                              return left.second != right.second ? left.second > right.second : left.first < right.first;
+                          });
+        std::fprintf(out, "  %zu-grams:\n", n);
+        for (std::size_t i = 0; i < shown; i++)
+            std::fprintf(out, "    %10zu  %.*s\n", ranked[i].second, static_cast<int>(ranked[i].first.size()),
+                         ranked[i].first.data());
+    }
+}
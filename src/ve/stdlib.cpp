@@ -1,3 +1,5 @@
+#include <cinttypes>
+#include <cstdio>
 #include <iostream>
 
 #include <parser/parser.hpp>
@@ -5,36 +7,34 @@
 
 using HSharpVE::ExpressionVisitorRetPair;
 
-void HSharpVE::VirtualEnvironment::StatementVisitor_StatementPrint(HSharpParser::NodeStmtPrint* stmt) {
-    ExpressionVisitorRetPair pair = std::visit(exprvisitor, stmt->expr->expr);
-    std::string result;
+void HSharpVE::VirtualEnvironment::exec_print(const HSharpParser::StmtNode& stmt) {
+    ExpressionVisitorRetPair pair = evaluate(stmt);
     switch (pair.type){
         case VariableType::INT:
-            result = std::to_string(*static_cast<int64_t*>(pair.value));
+            std::printf("%" PRId64 "\n", *static_cast<int64_t*>(pair.value));
             break;
         case VariableType::STRING:
-            result = *static_cast<std::string*>(pair.value);
+            std::puts(static_cast<std::pmr::string*>(pair.value)->c_str());
             break;
         default:
             throwFatalVirtualEnvException("print(): conversion failed: unknown type");
     }
-    std::puts(result.c_str());
 
     dispose_value(pair);
 }
 
-void HSharpVE::VirtualEnvironment::StatementVisitor_StatementExit(HSharpParser::NodeStmtExit* stmt) {
+void HSharpVE::VirtualEnvironment::exec_exit(const HSharpParser::StmtNode& stmt) {
     int64_t exitcode;
-    ExpressionVisitorRetPair pair = std::visit(exprvisitor, stmt->expr->expr);
+    ExpressionVisitorRetPair pair = evaluate(stmt);
     switch(pair.type){
         case VariableType::INT:
             exitcode = *static_cast<int64_t*>(pair.value);
             break;
         case VariableType::STRING:{
-            std::string* ptr = static_cast<std::string*>(pair.value);
+            std::pmr::string* ptr = static_cast<std::pmr::string*>(pair.value);
             if (!is_number(*ptr))
                 throwFatalVirtualEnvException("exit(): conversion failed: string is not convertable to number");
-            exitcode = std::stol(*ptr);
+            exitcode = to_integer(*ptr);
             break;
         }
         default:
@@ -45,55 +45,58 @@ void HSharpVE::VirtualEnvironment::StatementVisitor_StatementExit(HSharpParser::
     exit(exitcode);
 }
 
-void HSharpVE::VirtualEnvironment::StatementVisitor_StatementVar(HSharpParser::NodeStmtVar* stmt) {
-    if (global_scope.variables.contains(stmt->ident.value.value())) {
+void HSharpVE::VirtualEnvironment::exec_var(const HSharpParser::StmtNode& stmt) {
+    if (is_variable(stmt.symbol)) {
         std::cerr << "Variable reinitialization is not allowed\n";
         exit(1);
     } else {
-        const ExpressionVisitorRetPair pair = std::visit(exprvisitor, stmt->expr->expr);
-        global_scope.variables[stmt->ident.value.value()] = {.vtype = pair.type, .value = pair.value};
+        const ExpressionVisitorRetPair pair = own(evaluate(stmt));
+        global_scope.variables[stmt.symbol] = {.vtype = pair.type, .value = pair.value};
     }
 }
 
-void HSharpVE::VirtualEnvironment::StatementVisitor_StatementVarAssign(HSharpParser::NodeStmtVarAssign *stmt) {
-    if (!is_variable(const_cast<char*>(stmt->ident.value.value().c_str())))
+void HSharpVE::VirtualEnvironment::exec_assign(const HSharpParser::StmtNode& stmt) {
+    if (!is_variable(stmt.symbol))
         throwFatalVirtualEnvException("AssignException: cannot assign value to immediate value");
-    auto variable = &global_scope.variables[stmt->ident.value.value().c_str()];
-    ExpressionVisitorRetPair info = std::visit(exprvisitor, stmt->expr->expr);
+    auto variable = &global_scope.variables[stmt.symbol];
+    const ExpressionVisitorRetPair info = own(evaluate(stmt));
+    ExpressionVisitorRetPair previous{.type = variable->vtype, .value = variable->value, .dealloc_required = true};
     variable->vtype = info.type;
-
     variable->value = info.value;
+    dispose_value(previous);
 }
 
-
-ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::ExpressionVisitor_ExprStrLit(NodeExpressionStrLit* expr) {
-    auto str = static_cast<std::string*>(strings_pool.malloc());
-    *str = std::string(expr->str_lit.value.value());
-    return {VariableType::STRING, str};
+ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::own(const ExpressionVisitorRetPair& pair) {
+    if (pair.dealloc_required)
+        return pair;
+    if (pair.type == VariableType::INT) {
+        auto value = integers_pool.malloc();
+        *value = *static_cast<int64_t*>(pair.value);
+        return {.type = VariableType::INT, .value = value, .dealloc_required = true};
+    }
+    auto str = static_cast<std::pmr::string*>(strings_pool.malloc());
+    new(str) std::pmr::string(*static_cast<std::pmr::string*>(pair.value), resource);
+    return {.type = VariableType::STRING, .value = str, .dealloc_required = true};
 }
 
-ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::ExpressionVisitor_ExprIntLit(HSharpParser::NodeTermIntLit* expr) {
-    if (!is_number(expr->int_lit.value.value())) {
-        std::cerr << "Expression is not valid integer!" << std::endl;
-        exit(1);
-    } else {
-        auto value = static_cast<int64_t*>(integers_pool.malloc());
-        *value = std::stol(expr->int_lit.value.value());
-        return {VariableType::INT, value};
-    }
+
+ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::eval_str_lit(const HSharpParser::ExprNode& node) {
+    auto str = static_cast<std::pmr::string*>(strings_pool.malloc());
+    new(str) std::pmr::string(program.string(node), resource);
+    return {.type = VariableType::STRING, .value = str, .dealloc_required = true};
 }
 
-ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::ExpressionVisitor_ExprIdent(HSharpParser::NodeTermIdent* expr) const {
-    if (!global_scope.variables.contains(expr->ident.value.value()))
-        std::terminate();
-    else {
-        return {
-            global_scope.variables.at(expr->ident.value.value()).vtype,
-            global_scope.variables.at(expr->ident.value.value()).value
-        };
-    }
+ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::eval_int_lit(const HSharpParser::ExprNode& node) {
+    auto value = integers_pool.malloc();
+    *value = node.int_value();
+    return {.type = VariableType::INT, .value = value, .dealloc_required = true};
 }
 
-ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::ExpressionVisitor_BinExpr(HSharpParser::NodeBinExpr *expr) const {
-    return {};
+ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::eval_ident(const HSharpParser::ExprNode& node) const {
+    if (!is_variable(node.a)) {
+        std::cerr << "Invalid identifier" << std::endl;
+        exit(1);
+    }
+    const Variable& variable = global_scope.variables[node.a];
+    return {variable.vtype, variable.value, false};
 }
@@ -0,0 +1,33 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include <ve/value.hpp>
+#include <ve/ve.hpp>
+
+void HSharpVE::fail_undefined_identifier() {
+    std::cerr << "Invalid identifier" << std::endl;
+    std::exit(1);
+}
+
+void HSharpVE::fail_redeclaration() {
+    std::cerr << "Variable reinitialization is not allowed\n";
+    std::exit(1);
+}
+
+void HSharpVE::print_value(const Value& value, const std::string_view string_data) {
+    if (value.type == ValueType::INT)
+        std::printf("%" PRId64 "\n", value.integer);
+    else
+        /* %.*s stops at a NUL byte, like the tree walker's puts() */
+        std::printf("%.*s\n", static_cast<int>(value.text.length), string_data.data() + value.text.offset);
+}
+
+void HSharpVE::exit_with_value(const Value& value, const std::string_view string_data) {
+    if (value.type == ValueType::INT)
+        std::exit(static_cast<int>(value.integer));
+    const std::string_view text = string_data.substr(value.text.offset, value.text.length);
+    if (!VirtualEnvironment::is_number(text))
+        throwFatalVirtualEnvException("exit(): conversion failed: string is not convertable to number");
+    std::exit(static_cast<int>(VirtualEnvironment::to_integer(text)));
+}
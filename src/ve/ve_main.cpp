@@ -1,45 +1,93 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <memory>
 
 #include <parser/parser.hpp>
+#include <ve/value.hpp>
 #include <ve/ve.hpp>
 
 using std::uint32_t;
+using HSharpVE::ExpressionVisitorRetPair;
 
-bool is_number(const std::string& s);
+void HSharpVE::VirtualEnvironment::exec_statement(const HSharpParser::StmtNode& stmt) {
+    switch (stmt.kind) {
+        case HSharpParser::StmtKind::EXIT: exec_exit(stmt); break;
+        case HSharpParser::StmtKind::PRINT: exec_print(stmt); break;
+        case HSharpParser::StmtKind::INPUT: throwFatalVirtualEnvException("Not implemented: input()");
+        case HSharpParser::StmtKind::VAR: exec_var(stmt); break;
+        case HSharpParser::StmtKind::ASSIGN: exec_assign(stmt); break;
+        case HSharpParser::StmtKind::IMPORT: throwFatalVirtualEnvException("Unresolved import: program was not linked");
+    }
+}
 
-void HSharpVE::VirtualEnvironment::exec_expression(const HSharpParser::NodeExpression* expr) {
-    std::visit(exprvisitor, expr->expr);
+ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::evaluate(const HSharpParser::StmtNode& stmt) {
+    value_stack.clear();
+    const HSharpParser::ExprNode* node = program.expressions.data() + stmt.first;
+    const HSharpParser::ExprNode* const end = node + stmt.count;
+    for (; node != end; node++) {
+        switch (node->kind) {
+            case HSharpParser::ExprKind::INT_LIT: value_stack.push_back(eval_int_lit(*node)); break;
+            case HSharpParser::ExprKind::IDENT: value_stack.push_back(eval_ident(*node)); break;
+            case HSharpParser::ExprKind::STR_LIT: value_stack.push_back(eval_str_lit(*node)); break;
+            default: value_stack.push_back(eval_arithmetic(node->kind));
+        }
+    }
+    assert(value_stack.size() == 1);
+    return value_stack.back();
 }
 
-void HSharpVE::VirtualEnvironment::exec_statement(const HSharpParser::NodeStmt* stmt) {
-    std::visit(stmtvisitor, stmt->statement);
+ExpressionVisitorRetPair HSharpVE::VirtualEnvironment::eval_arithmetic(const HSharpParser::ExprKind kind) {
+    ExpressionVisitorRetPair rhs = value_stack.back();
+    value_stack.pop_back();
+    ExpressionVisitorRetPair lhs = value_stack.back();
+    value_stack.pop_back();
+    if (lhs.type != VariableType::INT || rhs.type != VariableType::INT)
+        throwFatalVirtualEnvException("Binary expression evaluation impossible: invalid literal type");
+    const std::int64_t left = *static_cast<int64_t*>(lhs.value);
+    const std::int64_t right = *static_cast<int64_t*>(rhs.value);
+    dispose_value(lhs);
+    dispose_value(rhs);
+    auto result = integers_pool.malloc();
+    using HSharpParser::ExprKind;
+    switch (kind) {
+        case ExprKind::ADD: *result = integer_arithmetic<ExprKind::ADD>(left, right); break;
+        case ExprKind::SUB: *result = integer_arithmetic<ExprKind::SUB>(left, right); break;
+        case ExprKind::MUL: *result = integer_arithmetic<ExprKind::MUL>(left, right); break;
+        case ExprKind::DIV: *result = integer_arithmetic<ExprKind::DIV>(left, right); break;
+        default: std::terminate();
+    }
+    return {.type = VariableType::INT, .value = result, .dealloc_required = true};
 }
 
 void HSharpVE::VirtualEnvironment::delete_variables() {
-    for (auto pair : global_scope.variables) {
-        switch (pair.second.vtype) {
-            case VariableType::INT: integers_pool.free(static_cast<int64_t*>(pair.second.value)); break;
-            case VariableType::STRING: strings_pool.free(pair.second.value); break;
-            default:
-                std::printf("Cannot dispose variable %s: unknown type, freeing impossible", pair.first.c_str());
+    for (std::uint32_t symbol = 0; symbol < global_scope.variables.size(); symbol++) {
+        const Variable& variable = global_scope.variables[symbol];
+        if (!variable.value)
+            continue;
+        switch (variable.vtype) {
+            case VariableType::INT: integers_pool.free(static_cast<int64_t*>(variable.value)); break;
+            case VariableType::STRING:
+                std::destroy_at(static_cast<std::pmr::string*>(variable.value));
+                strings_pool.free(variable.value);
+                break;
+            default: {
+                const std::string_view name = symbols.name(symbol);
+                std::printf("Cannot dispose variable %.*s: unknown type, freeing impossible", static_cast<int>(name.size()), name.data());
+            }
         }
     }
     global_scope.variables.clear();
 }
 
-bool HSharpVE::VirtualEnvironment::is_variable(char* name) {
-    auto it = std::find_if(std::begin(global_scope.variables), std::end(global_scope.variables), [name](auto&& arg) {
-        return !strcmp(arg.first.c_str(), name);
-    });
-    return it != std::end(global_scope.variables);
+bool HSharpVE::VirtualEnvironment::is_variable(const std::uint32_t symbol) const {
+    return symbol < global_scope.variables.size() && global_scope.variables[symbol].value;
 }
 
 bool HSharpVE::VirtualEnvironment::is_variable_value(void* value) {
     auto it = std::find_if(std::begin(global_scope.variables),
         std::end(global_scope.variables), [value](auto&& arg) {
-            return arg.second.value == value;
+            return arg.value == value;
         });
     return it != std::end(global_scope.variables);
 }
@@ -48,20 +96,30 @@ void HSharpVE::VirtualEnvironment::dispose_value(ExpressionVisitorRetPair& data)
     if (!data.dealloc_required) return;
     switch (data.type) {
         case VariableType::INT: integers_pool.free(static_cast<int64_t*>(data.value)); break;
-        case VariableType::STRING: strings_pool.free(data.value); break;
+        case VariableType::STRING:
+            std::destroy_at(static_cast<std::pmr::string*>(data.value));
+            strings_pool.free(data.value);
+            break;
         default: std::terminate();
     }
 }
 
 void HSharpVE::VirtualEnvironment::run() {
-    global_scope = {};
-    for (const HSharpParser::NodeStmt* stmt : root.statements) {
+    global_scope.variables.assign(symbols.size(), Variable{});
+    for (const HSharpParser::StmtNode& stmt : program.statements) {
         exec_statement(stmt);
     }
 }
 
-bool HSharpVE::VirtualEnvironment::is_number(const std::string& s) {
-    std::string::const_iterator it = s.begin();
+bool HSharpVE::VirtualEnvironment::is_number(std::string_view s) {
+    auto it = s.begin();
     while (it != s.end() && std::isdigit(*it)) ++it;
     return !s.empty() && it == s.end();
+}
+
+std::int64_t HSharpVE::VirtualEnvironment::to_integer(std::string_view s) {
+    std::int64_t value = 0;
+    if (std::from_chars(s.data(), s.data() + s.size(), value).ec != std::errc{})
+        throwFatalVirtualEnvException("Integer literal is out of range");
+    return value;
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <iterator>
+
+#include <ve/bytecode.hpp>
+#include <ve/exceptions.hpp>
+#include <ve/jit.hpp>
+
+#define HSHARP_VM_ARITHMETIC(KIND)                                                                               \
+    slot[ip->a] = arithmetic<HSharpParser::ExprKind::KIND>(slot[ip->b], slot[ip->c]);                           \
+    ip++;                                                                                                        \
+    DISPATCH();
+
+void HSharpVE::BytecodeVM::run(const JitCode* jit) {
+    slots.assign(program.constants.begin(), program.constants.end());
+    slots.resize(program.constants.size() + program.register_count);
+    globals.assign(symbols.size(), Value{});
+    Value* const slot = slots.data();
+    Value* const global = globals.data();
+    const Instruction* ip = program.code.data();
+    if (jit)
+        ip += jit->run(slot, global, program.string_data);
+
+    /* Computed goto: every handler ends in its own indirect jump, so each gets its own branch
+     * history instead of all sharing the one of a switch */
+    static constexpr void* labels[] = {
+        &&load_global, &&add, &&sub, &&mul, &&div,
+        &&check_undeclared, &&check_declared, &&store_global,
+        &&print, &&exit, &&input,
+        &&add_global, &&print_global, &&declare, &&halt
+    };
+    static_assert(std::size(labels) == opcode_count);
+#define DISPATCH() goto *labels[static_cast<std::size_t>(ip->op)]
+
+    DISPATCH();
+load_global:
+    if (global[ip->b].type == ValueType::UNDEFINED) [[unlikely]]
+        fail_undefined_identifier();
+    slot[ip->a] = global[ip->b];
+    ip++;
+    DISPATCH();
+add:
+    HSHARP_VM_ARITHMETIC(ADD)
+sub:
+    HSHARP_VM_ARITHMETIC(SUB)
+mul:
+    HSHARP_VM_ARITHMETIC(MUL)
+div:
+    HSHARP_VM_ARITHMETIC(DIV)
+check_undeclared:
+    if (global[ip->a].type != ValueType::UNDEFINED) [[unlikely]]
+        fail_redeclaration();
+    ip++;
+    DISPATCH();
+check_declared:
+    if (global[ip->a].type == ValueType::UNDEFINED) [[unlikely]]
+        throwFatalVirtualEnvException("AssignException: cannot assign value to immediate value");
+    ip++;
+    DISPATCH();
+store_global:
+    global[ip->a] = slot[ip->b];
+    ip++;
+    DISPATCH();
+print:
+    print_value(slot[ip->a], program.string_data);
+    ip++;
+    DISPATCH();
+exit:
+    exit_with_value(slot[ip->a], program.string_data);
+input:
+    throwFatalVirtualEnvException("Not implemented: input()");
+add_global: {
+    Value& target = global[ip->a];
+    if (target.type == ValueType::UNDEFINED) [[unlikely]]
+        throwFatalVirtualEnvException("AssignException: cannot assign value to immediate value");
+    target = arithmetic<HSharpParser::ExprKind::ADD>(target, slot[ip->b]);
+    ip++;
+    DISPATCH();
+}
+print_global:
+    if (global[ip->a].type == ValueType::UNDEFINED) [[unlikely]]
+        fail_undefined_identifier();
+    print_value(global[ip->a], program.string_data);
+    ip++;
+    DISPATCH();
+declare:
+    if (global[ip->a].type != ValueType::UNDEFINED) [[unlikely]]
+        fail_redeclaration();
+    global[ip->a] = slot[ip->b];
+    ip++;
+    DISPATCH();
+halt:
+    return;
+#undef DISPATCH
+}
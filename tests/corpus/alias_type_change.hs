@@ -0,0 +1,12 @@
+var s = "a string";
+var t = s;
+print(t);
+s = 5;
+print(t);
+print(s + 1);
+t = s * 2;
+print(t);
+s = "again";
+t = s;
+print(t);
+print(s + 1);
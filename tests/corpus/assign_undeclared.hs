@@ -0,0 +1,4 @@
+var a = 1;
+print(a);
+missing = 2;
+print(missing);
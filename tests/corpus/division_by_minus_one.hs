@@ -0,0 +1,8 @@
+var a = 0 - 9223372036854775807 - 1;
+var m = 0 - 1;
+print(a / (0 - 1));
+print(a / m);
+print(7 / m);
+print(1 + (1 + (1 + (1 + (1 + (1 + (1 + a / m)))))) - 7);
+print(a * m);
+print(a - 1);
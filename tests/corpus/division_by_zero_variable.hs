@@ -0,0 +1,6 @@
+var a = 7;
+var z = 0;
+print(a / 7);
+print(a * 2 - a / (z + 1));
+print(a / z);
+print(a);
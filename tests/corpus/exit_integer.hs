@@ -0,0 +1,4 @@
+var code = 6;
+print(code);
+exit(code / 2);
+print(code);
@@ -0,0 +1,3 @@
+print(1);
+exit("bye");
+print(2);
@@ -0,0 +1,8 @@
+var x = 1;
+print(x + 1);
+x = "text";
+print(x);
+x = 2;
+print(x * 3);
+var y = x + x;
+print(y);
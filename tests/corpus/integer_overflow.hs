@@ -0,0 +1,7 @@
+var big = 9223372036854775807;
+print(big + 1);
+print(big * big);
+print(0 - big - 2);
+var n = big;
+n = n + 1;
+print(n);
@@ -0,0 +1,6 @@
+var a = 1;
+print(a);
+var b = a + 1;
+print(b);
+var a = 3;
+print(a);
@@ -0,0 +1,3 @@
+var a = "text";
+print(a);
+print(a - 1);
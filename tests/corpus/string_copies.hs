@@ -0,0 +1,11 @@
+var a = "heap string";
+var d = a;
+a = "another heap string";
+print(d);
+print(a);
+d = d;
+print(d);
+var e = d;
+e = 5;
+print(d);
+print(e);
@@ -0,0 +1,4 @@
+var a = 1;
+print(a);
+print(a + missing);
+print(a);
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Runs hve_ng with every engine, with and without --dedup, on each program of a corpus
+ * directory, on a program nested deeper than the closure compiler recurses and on seeded random
+ * programs, and fails unless every run prints the same stdout and stderr and exits with the
+ * same status as the tree walker without --dedup. Only --dedup makes a closure node run more
+ * than once, and so exercises quickening and deoptimization.
+ *
+ * Usage: engine_differential HVE_NG CORPUS_DIR [RANDOM_PROGRAMS [SEED]] */
+namespace {
+    struct Variant {
+        const char* engine;
+        bool deduplicate;
+    };
+
+    /* The first one is the reference */
+    constexpr Variant variants[] = {
+        {"tree", false}, {"bytecode", false}, {"closure", false}, {"jit", false},
+        {"tree", true}, {"bytecode", true}, {"closure", true}, {"jit", true},
+    };
+    constexpr std::size_t deep_expression_depth = 5000;
+
+    struct Outcome {
+        std::string out;
+        std::string err;
+        int status = -1;
+        /* The signal that killed it, 0 if it exited */
+        int signal = 0;
+
+        bool operator==(const Outcome&) const = default;
+    };
+
+    std::string read_file(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    void write_file(const std::filesystem::path& path, const std::string& contents) {
+        std::ofstream(path, std::ios::binary) << contents;
+    }
+
+    Outcome run(const std::string& binary, const Variant& variant, const std::filesystem::path& program,
+                const std::filesystem::path& scratch) {
+        const std::filesystem::path out_path = scratch / "stdout", err_path = scratch / "stderr";
+        const std::string engine_flag = std::string("--engine=") + variant.engine;
+        std::vector<char*> arguments = {const_cast<char*>(binary.c_str()), const_cast<char*>("--no-cache"),
+                                        const_cast<char*>(engine_flag.c_str())};
+        if (variant.deduplicate)
+            arguments.push_back(const_cast<char*>("--dedup"));
+        arguments.push_back(const_cast<char*>(program.c_str()));
+        arguments.push_back(nullptr);
+        const pid_t child = fork();
+        if (child == 0) {
+            const int out = ::open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            const int err = ::open(err_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            if (out < 0 || err < 0 || dup2(out, STDOUT_FILENO) < 0 || dup2(err, STDERR_FILENO) < 0)
+                _exit(127);
+            execv(binary.c_str(), arguments.data());
+            _exit(127);
+        }
+        Outcome outcome;
+        int status = 0;
+        if (child < 0 || waitpid(child, &status, 0) != child)
+            return outcome;
+        if (WIFEXITED(status))
+            outcome.status = WEXITSTATUS(status);
+        else
+            outcome.signal = WTERMSIG(status);
+        outcome.out = read_file(out_path);
+        outcome.err = read_file(err_path);
+        return outcome;
+    }
+
+    /* True if every variant matches the reference on program */
+    bool compare(const std::string& binary, const std::filesystem::path& program, const std::filesystem::path& scratch) {
+        const Outcome reference = run(binary, variants[0], program, scratch);
+        if (reference.status < 0 || reference.signal != 0) {
+            std::fprintf(stderr, "FAIL %s: the tree walker did not run to an exit (signal %d)\n", program.c_str(),
+                         reference.signal);
+            return false;
+        }
+        bool match = true;
+        for (std::size_t i = 1; i < std::size(variants); i++) {
+            const Variant& variant = variants[i];
+            const Outcome outcome = run(binary, variant, program, scratch);
+            if (outcome == reference)
+                continue;
+            const char* dedup = variant.deduplicate ? " --dedup" : "";
+            std::fprintf(stderr, "FAIL %s: %s%s differs from tree\n  tree (status %d): %s%s  %s%s (status %d, signal %d): %s%s",
+                         program.c_str(), variant.engine, dedup, reference.status, reference.out.c_str(),
+                         reference.err.c_str(), variant.engine, dedup, outcome.status, outcome.signal,
+                         outcome.out.c_str(), outcome.err.c_str());
+            match = false;
+        }
+        return match;
+    }
+
+    /* Deterministic on every platform, unlike the standard distributions */
+    class Random {
+    private:
+        std::uint64_t state;
+
+    public:
+        explicit Random(const std::uint64_t seed) : state(seed) {}
+
+        std::uint64_t next() {
+            state += 0x9e3779b97f4a7c15ull;
+            std::uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+        std::size_t below(const std::size_t bound) { return next() % bound; }
+    };
+
+    /* Random programs over a few globals: declarations, assignments and prints of expressions
+     * mixing integers, strings and globals, so that sooner or later one divides by zero or by
+     * -1, changes a global's type, redeclares, reads something undeclared or exits. Expressions
+ * recur, so that a node --dedup shares sees a global before and after its type changes. */
+    class ProgramGenerator {
+    private:
+        Random random;
+        /* Statement expressions so far, repeated now and then for --dedup to share */
+        std::vector<std::string> expressions;
+
+        std::string name() {
+            return "g" + std::to_string(random.below(6));
+        }
+
+        std::string literal() {
+            static constexpr const char* literals[] = {"0", "1", "2", "7", "(0 - 1)", "9223372036854775807",
+                                                       "(0 - 9223372036854775807 - 1)", "4611686018427387904"};
+            return literals[random.below(std::size(literals))];
+        }
+
+        std::string expression(const std::size_t depth) {
+            const std::size_t pick = random.below(depth == 0 ? 10 : 16);
+            if (pick < 4)
+                return literal();
+            if (pick < 9)
+                return name();
+            if (pick == 9)
+                return random.below(4) == 0 ? "\"text\"" : literal();
+            static constexpr const char* operators[] = {" + ", " - ", " * ", " / "};
+            const std::string left = expression(depth - 1), right = expression(depth - 1);
+            const std::string combined = left + operators[random.below(std::size(operators))] + right;
+            return random.below(2) == 0 ? "(" + combined + ")" : combined;
+        }
+
+    public:
+        explicit ProgramGenerator(const std::uint64_t seed) : random(seed) {}
+
+        std::string generate() {
+            std::string source;
+            /* Most runs declare everything up front, so that they get further than one statement */
+            for (std::size_t i = 0; i < 6; i++)
+                if (random.below(5) != 0)
+                    source += "var g" + std::to_string(i) + " = " + literal() + ";\n";
+            const std::size_t statements = 10 + random.below(30);
+            for (std::size_t i = 0; i < statements; i++) {
+                const std::size_t pick = random.below(20);
+                std::string value;
+                if (!expressions.empty() && random.below(3) == 0) {
+                    value = expressions[random.below(expressions.size())];
+                } else {
+                    value = expression(random.below(4));
+                    expressions.push_back(value);
+                }
+                if (pick == 0)
+                    source += "var " + name() + " = " + value + ";\n";
+                else if (pick == 1)
+                    source += "exit(" + value + ");\n";
+                else if (pick < 8)
+                    source += name() + " = " + value + ";\n";
+                else if (pick < 10)
+                    source += name() + " = \"s" + std::to_string(i) + "\";\n";
+                else
+                    source += "print(" + value + ");\n";
+            }
+            return source;
+        }
+    };
+}
+
+int main(const int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s HVE_NG CORPUS_DIR [RANDOM_PROGRAMS [SEED]]\n", argv[0]);
+        return 2;
+    }
+    const std::string binary = argv[1];
+    if (access(binary.c_str(), X_OK) != 0) {
+        std::fprintf(stderr, "%s is not executable\n", binary.c_str());
+        return 2;
+    }
+    const std::filesystem::path corpus = argv[2];
+    const std::size_t random_programs = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 200;
+    const std::uint64_t seed = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+
+    const std::filesystem::path scratch = std::filesystem::temp_directory_path()
+                                          / ("hsharpve-differential-" + std::to_string(getpid()));
+    std::filesystem::create_directories(scratch);
+    std::size_t programs = 0, failures = 0;
+
+    std::vector<std::filesystem::path> files;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(corpus))
+        if (entry.path().extension() == ".hs")
+            files.push_back(entry.path());
+    std::ranges::sort(files);
+    if (files.empty()) {
+        std::fprintf(stderr, "FAIL %s: no programs\n", corpus.c_str());
+        failures++;
+    }
+    for (const std::filesystem::path& file : files) {
+        programs++;
+        failures += !compare(binary, file, scratch);
+    }
+
+    std::string deep = "var a = 0 - 1;\nprint(a";
+    for (std::size_t i = 0; i < deep_expression_depth; i++)
+        deep += " + 1";
+    write_file(scratch / "deep_expression.hs", deep + ");\n");
+    programs++;
+    failures += !compare(binary, scratch / "deep_expression.hs", scratch);
+
+    /* A failing random program is kept under its seed for reproducing */
+    for (std::size_t i = 0; i < random_programs; i++) {
+        const std::uint64_t program_seed = seed + i;
+        const std::filesystem::path path = scratch / ("random-" + std::to_string(program_seed) + ".hs");
+        write_file(path, ProgramGenerator(program_seed).generate());
+        programs++;
+        if (compare(binary, path, scratch)) {
+            std::filesystem::remove(path);
+        } else {
+            const std::filesystem::path kept = std::filesystem::temp_directory_path() / path.filename();
+            std::filesystem::copy_file(path, kept, std::filesystem::copy_options::overwrite_existing);
+            std::fprintf(stderr, "  program kept as %s\n", kept.c_str());
+            failures++;
+        }
+    }
+
+    std::filesystem::remove_all(scratch);
+    std::printf("engine differential: %zu programs, %zu variants, %zu failing\n", programs, std::size(variants), failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <string>
+
+#include <unistd.h>
+
+#include <bench/generator.hpp>
+#include <main/compilation.hpp>
+#include <thread_pool/thread_pool.hpp>
+#include <ve/ve.hpp>
+
+/* Drives one Compilation of a program with imports through every stage and checks that no
+ * stage copies a container it only hands on. Heap allocations are counted through operator
+ * new; arena growth, which bypasses it, through both arenas' stats. */
+namespace {
+    std::atomic<std::size_t> allocation_count{0};
+    std::atomic<std::size_t> allocated_bytes{0};
+}
+
+/* Out of line for the same reason as in hve_bench: inlined, GCC pairs the free() with a
+ * new-expression and warns */
+[[gnu::noinline]] void* operator new(const std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](const std::size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+    constexpr std::size_t root_statements = 2000;
+    constexpr std::size_t module_count = 4;
+    constexpr std::size_t module_statements = 500;
+
+    struct Usage {
+        std::size_t allocations = 0;
+        std::size_t bytes = 0;
+        HSharpParser::ArenaStats arena;
+        HSharpParser::ArenaStats token_arena;
+    };
+
+    Usage usage(const HSharpParser::Compilation& compilation) {
+        return {allocation_count.load(), allocated_bytes.load(), compilation.arena_stats(),
+                compilation.token_arena_stats()};
+    }
+
+    /* What a stage cost: heap allocations, and bytes handed out and chunks added by each arena;
+     * negative for an arena the stage freed */
+    struct Cost {
+        std::ptrdiff_t allocations;
+        std::ptrdiff_t bytes;
+        std::ptrdiff_t arena_bytes;
+        std::ptrdiff_t arena_chunks;
+        std::ptrdiff_t token_bytes;
+        std::ptrdiff_t token_chunks;
+    };
+
+    std::ptrdiff_t delta(const std::size_t before, const std::size_t after) {
+        return static_cast<std::ptrdiff_t>(after) - static_cast<std::ptrdiff_t>(before);
+    }
+
+    Cost cost(const Usage& before, const Usage& after) {
+        return {delta(before.allocations, after.allocations), delta(before.bytes, after.bytes),
+                delta(before.arena.bytes_used, after.arena.bytes_used), delta(before.arena.chunks, after.arena.chunks),
+                delta(before.token_arena.bytes_used, after.token_arena.bytes_used),
+                delta(before.token_arena.chunks, after.token_arena.chunks)};
+    }
+
+    std::ptrdiff_t ast_bytes(const HSharpParser::NodeProgram& program) {
+        return static_cast<std::ptrdiff_t>(program.statements.size() * sizeof(HSharpParser::StmtNode)
+                                           + program.expressions.size() * sizeof(HSharpParser::ExprNode)
+                                           + program.string_data.size());
+    }
+
+    bool failed = false;
+
+    void check(const char* stage, const bool passed, const char* what) {
+        if (!passed) {
+            std::fprintf(stderr, "FAIL %s: %s\n", stage, what);
+            failed = true;
+        }
+    }
+
+    void report(const char* stage, const Cost& cost) {
+        std::printf("%-18s %8td allocations %10td bytes | arena %10td bytes %3td chunks | token arena %10td bytes %3td chunks\n",
+                    stage, cost.allocations, cost.bytes, cost.arena_bytes, cost.arena_chunks, cost.token_bytes,
+                    cost.token_chunks);
+    }
+
+    void write_file(const std::filesystem::path& path, const std::string& contents) {
+        std::ofstream(path, std::ios::binary) << contents;
+    }
+}
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path()
+                                            / ("hsharpve-pipeline-" + std::to_string(getpid()));
+    std::filesystem::create_directories(directory);
+    std::string root = HSharpBench::generate(HSharpBench::Workload::EXPRESSIONS, root_statements);
+    for (std::size_t i = 0; i < module_count; i++) {
+        const std::string name = "module" + std::to_string(i) + ".hs";
+        /* Own variable names, so that the linked program does not redeclare anything */
+        std::string module = HSharpBench::generate(HSharpBench::Workload::EXPRESSIONS, module_statements);
+        for (std::size_t at = 0; (at = module.find('v', at)) != std::string::npos; at++)
+            if (std::isdigit(static_cast<unsigned char>(module[at + 1])))
+                module.insert(at++, 1, static_cast<char>('a' + i));
+        write_file(directory / name, module);
+        root += "import \"" + name + "\";\n";
+    }
+    write_file(directory / "root.hs", root);
+
+    std::optional<HSharpParser::Compilation> opened = HSharpParser::Compilation::open(directory / "root.hs");
+    if (!opened)
+        return 1;
+    HSharpParser::Compilation* live = &opened.value();
+    const auto stage = [&](const char* name, auto&& body) {
+        const Usage before = usage(*live);
+        body();
+        const Cost spent = cost(before, usage(*live));
+        report(name, spent);
+        return spent;
+    };
+
+    const auto source_bytes = static_cast<std::ptrdiff_t>(live->source_file().size());
+    const Cost tokenize = stage("tokenize", [&] { live->tokenize(); });
+    const auto token_bytes = static_cast<std::ptrdiff_t>(live->token_count() * sizeof(HSharpParser::Token));
+    /* Tokens go to their arena, reserved once; only symbols may reach the heap */
+    check("tokenize", tokenize.token_bytes >= token_bytes && tokenize.token_bytes < 2 * token_bytes,
+          "tokens not lexed into one reservation in the token arena");
+    check("tokenize", tokenize.arena_bytes == 0, "allocated from the AST arena");
+    check("tokenize", tokenize.bytes < source_bytes, "heap holds a copy of the source");
+
+    const Cost parse = stage("parse", [&] { live->parse(); });
+    const std::ptrdiff_t root_ast_bytes = ast_bytes(live->ast());
+    /* Vectors growing in an arena leave every outgrown buffer behind, which comes to about
+     * 3.3 times the final arrays here; one more copy of the AST would exceed 4 */
+    check("parse", parse.bytes < token_bytes, "heap holds a copy of the tokens");
+    check("parse", parse.token_bytes == 0, "token arena holds a copy of the tokens");
+    check("parse", parse.arena_bytes >= root_ast_bytes && parse.arena_bytes < 4 * root_ast_bytes,
+          "AST arena growth out of proportion to the AST");
+
+    check("link", live->has_imports(), "generated root has no imports");
+    HSharpParser::ThreadPool pool(2);
+    const Cost link = stage("link", [&] { check("link", live->link(pool), "loading the modules failed"); });
+    const std::ptrdiff_t linked_ast_bytes = ast_bytes(live->ast());
+    check("link", live->module_count() == module_count + 1, "not every module was linked");
+    /* The linked program is built once into the arena; modules parse into arenas of their own */
+    check("link", link.arena_bytes >= linked_ast_bytes && link.arena_bytes < 4 * linked_ast_bytes,
+          "AST arena growth out of proportion to the linked program");
+    check("link", link.bytes < root_ast_bytes, "heap holds a copy of the root program");
+    check("link", link.token_bytes == 0, "token arena grew");
+
+    std::optional<HSharpParser::Compilation> moved;
+    const Cost move = stage("move", [&] {
+        moved.emplace(std::move(*live));
+        live = &moved.value();
+    });
+    check("move", move.allocations == 0 && move.arena_bytes == 0 && move.token_bytes == 0, "allocated");
+
+    const HSharpParser::ArenaStats tokens_held = live->token_arena_stats();
+    const Cost release = stage("release_front_end", [&] { live->release_front_end(); });
+    check("release_front_end", release.allocations == 0 && release.arena_bytes == 0, "allocated");
+    check("release_front_end", tokens_held.chunks > 0 && live->token_arena_stats().chunks == 0,
+          "token arena not freed");
+
+    HSharpParser::ProgramView view;
+    const Cost viewed = stage("view", [&] { view = live->view(); });
+    check("view", viewed.allocations == 0 && viewed.arena_bytes == 0, "allocated");
+    check("view", view.expressions.data() == live->ast().expressions.data(), "view does not alias the AST");
+
+    std::pmr::unsynchronized_pool_resource runtime_memory(live->memory());
+    std::optional<HSharpVE::VirtualEnvironment> ve;
+    const Cost construct = stage("construct_ve", [&] {
+        ve.emplace(view, live->symbol_table(), false, &runtime_memory);
+    });
+    check("construct_ve", construct.allocations == 0 && construct.arena_bytes == 0 && construct.arena_chunks == 0,
+          "allocated");
+
+    ve.reset();
+    std::filesystem::remove_all(directory);
+    std::printf("token bytes %td, root AST bytes %td, linked AST bytes %td\n", token_bytes, root_ast_bytes,
+                linked_ast_bytes);
+    std::puts(failed ? "pipeline allocations: FAILED" : "pipeline allocations: ok");
+    return failed ? 1 : 0;
+}